@@ -0,0 +1,68 @@
+// Fill benchmark for the GoodStuenPanel library.
+// Compares filling rectangles a pixel at a time through drawPixel() --
+// which is what Adafruit_GFX's generic fillRect() and span primitives
+// boil down to -- against the packed-buffer fast paths, and prints
+// fills per second for each over the serial port.
+
+#include <GoodStuenPanel.h> // Hardware-specific library
+
+#define R1 2
+#define G1 3
+#define B1 4
+#define R2 5
+#define G2 6
+#define B2 7
+#define CLK 8
+#define OE  9
+#define A   10
+#define B   11
+#define C   12
+#define LAT 13
+
+GoodStuenPanel matrix(R1, G1, B1, R2, G2, B2, A, B, C, CLK, LAT, OE, false);
+
+// Fill a rectangle the slow way, as the generic Adafruit_GFX code does
+void slowFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t c) {
+  for (int16_t i = x; i < x + w; i++) {
+    for (int16_t j = y; j < y + h; j++) matrix.drawPixel(i, j, c);
+  }
+}
+
+// Time 'n' fills of a w x h rectangle (cycling through a few colors, so
+// the fast path's color cache doesn't flatter it) and print the rate.
+void bench(const char *label, boolean fast, int16_t w, int16_t h, uint16_t n) {
+  uint32_t t;
+  uint16_t i, c;
+
+  t = micros();
+  for (i = 0; i < n; i++) {
+    c = matrix.Color333(i & 7, (i >> 1) & 7, (i >> 2) & 7);
+    if (fast) matrix.fillRect(0, 0, w, h, c);
+    else      slowFillRect(0, 0, w, h, c);
+  }
+  t = micros() - t;
+  Serial.print(label);
+  Serial.print(' ');
+  Serial.print(w);
+  Serial.print('x');
+  Serial.print(h);
+  Serial.print(": ");
+  Serial.print((uint32_t)n * 1000000UL / t);
+  Serial.println(" fills/s");
+}
+
+void setup() {
+  Serial.begin(9600);
+  matrix.begin();
+}
+
+void loop() {
+  bench("drawPixel", false, matrix.width(), matrix.height(), 100);
+  bench("fillRect ", true,  matrix.width(), matrix.height(), 100);
+  bench("drawPixel", false, 8, 8, 1000);
+  bench("fillRect ", true,  8, 8, 1000);
+  bench("drawPixel", false, matrix.width(), 1, 1000);
+  bench("fillRect ", true,  matrix.width(), 1, 1000);
+  Serial.println();
+  delay(5000);
+}
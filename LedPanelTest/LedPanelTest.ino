@@ -23,18 +23,28 @@
 #define B   11
 #define C   12
 #define LAT 13
+// For the faster parallel bus mode, put R1-B2 on consecutive bits of one
+// PIO port instead, e.g. pins 33-38 (PC1-PC6), ideally with CLK on 39 (PC7).
+// OE on pin 2 (TIOA0) lets the refresh timer drive it, so setBrightness()
+// costs no extra interrupts.
+
+// Must outlive setup(): the refresh interrupt keeps using it.
+GoodStuenPanel matrix(R1, G1, B1, R2, G2, B2, A, B, C, CLK, LAT, OE, false);
+// Or with the geometry fixed at compile time (faster drawing and refresh):
+//GoodStuenPanel16x32 matrix(R1, G1, B1, R2, G2, B2, A, B, C, CLK, LAT, OE, false);
 
 void setup() {
   Serial.begin(9600);
 
-  GoodStuenPanel matrix(R1, G1, B1, R2, G2, B2, A, B, C, CLK, LAT, OE, false);
-
   // Testing interrupt - use LED
   //pinMode(13, OUTPUT); // LAT is also pin 13... so can't do this
   
   
   
+  // Smoother gradients from 4 planes: alternate LSBs between refreshes
+  //matrix.enableDither(1);
   matrix.begin();
+  matrix.enableStats(true);
   
   matrix.drawPixel(0, 0, matrix.Color333(7, 7, 7));
   /*delay(2000);
@@ -112,5 +122,36 @@ void setup() {
 }
 
 void loop() {
-  // do nothing
+  static int seconds = 0;
+
+  // Report how long the interrupt spends shifting out one row, and the
+  // resulting CPU load.  After 10 seconds, switch to DMA scan-out (if the
+  // wiring allows it) to compare.
+  Serial.print("Row shift cycles: ");
+  Serial.print(matrix.rowCycles());
+  Serial.print("  CPU load %: ");
+  Serial.println(matrix.cpuLoad());
+
+  // Profile of the refresh interrupt over the last second
+  GoodStuenStats stats;
+  matrix.getStats(&stats, true);
+  Serial.print("ISR cycles min/mean/max: ");
+  Serial.print(stats.all.min);
+  Serial.print('/');
+  Serial.print(stats.all.mean);
+  Serial.print('/');
+  Serial.print(stats.all.max);
+  Serial.print("  fps: ");
+  Serial.print(stats.fps);
+  Serial.print("  load %: ");
+  Serial.println(stats.cpuLoad);
+
+  // Anything logged by trace points.  TRACE_LEVEL has to be raised in
+  // GoodStuenPanel.h or with a build flag; defining it here does nothing.
+  GoodStuenPanel::drainTrace(Serial, 64);
+  if (++seconds == 10) {
+    Serial.println(matrix.enableDMA() ? "DMA scan-out enabled" :
+      "DMA scan-out needs R1-B2 and CLK on one PIO port");
+  }
+  delay(1000);
 }
@@ -0,0 +1,59 @@
+// Frame streaming receiver for the GoodStuenPanel library.
+// Shows frames sent from a PC over the Due's native USB port (SerialUSB),
+// already packed in the panel's buffer layout, whole or as deltas
+// against the previous frame -- see receiveFrames(), and
+// extras/host/sendframes.cpp in the library for a sender.  Prints
+// frames and bytes per second received over the programming port
+// (Serial) every two seconds, along with the frame size it expects.
+
+#include <GoodStuenPanel.h> // Hardware-specific library
+
+#define R1 2
+#define G1 3
+#define B1 4
+#define R2 5
+#define G2 6
+#define B2 7
+#define CLK 8
+#define OE  9
+#define A   10
+#define B   11
+#define C   12
+#define D   14
+#define LAT 13
+
+// Double buffered, so frames only ever show up complete.  The sender
+// has to be told the same geometry and plane count (-s 32 -p 4).
+GoodStuenPanel matrix(R1, G1, B1, R2, G2, B2, A, B, C, D, CLK, LAT, OE, true, 4);
+
+uint32_t last;
+
+void setup() {
+  Serial.begin(115200);
+  SerialUSB.begin(0); // Native USB: the baud rate doesn't matter
+  matrix.begin();
+  Serial.print("Waiting for ");
+  Serial.print(matrix.bufferSize());
+  Serial.println(" byte frames on SerialUSB");
+  last = millis();
+}
+
+void loop() {
+  GoodStuenStreamStats s;
+
+  matrix.receiveFrames(SerialUSB);
+  if ((millis() - last) >= 2000) {
+    last = millis();
+    matrix.getStreamStats(&s, true);
+    Serial.print(s.fps);
+    Serial.print(" frames/s, ");
+    Serial.print(s.bps);
+    Serial.print(" bytes/s");
+    if (s.errors) {
+      Serial.print(", ");
+      Serial.print(s.errors);
+      Serial.print(" skipped");
+    }
+    Serial.println();
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef _GOODSTUENHAL_H_
+#define _GOODSTUENHAL_H_
+
+// The hardware GoodStuenPanel drives, in one place.  The library talks to
+// the SAM3X directly: PIO controller registers (SODR/CODR/ODSR/OWER) for
+// pins, TC0 channel 0 for BCM timing, NVIC for its interrupt, the DMA
+// controller, and the DWT cycle counter for profiling.  On the Due these
+// are just the Arduino core's definitions, at no cost.  Built on Linux
+// with extras/host on the include path, that directory's Arduino.h
+// supplies the same names instead: registers become objects that feed a
+// HUB75 panel emulator, and the timer interrupt runs in virtual time.
+// See extras/host/README.txt.
+
+#include "Arduino.h"
+
+#ifdef GOODSTUEN_HOST
+
+// Tell the emulator which pins form the panel: 'chains' groups of six
+// data pins (R1,G1,B1,R2,G2,B2), the address, clock, latch and output
+// enable pins ('d' 0 for 8 scan rows), and the chain geometry.
+void halAttachPanel(const uint8_t *datapins, uint8_t chains,
+	uint8_t a, uint8_t b, uint8_t c, uint8_t d,
+	uint8_t sclk, uint8_t latch, uint8_t oe, uint16_t cols, uint8_t rows);
+
+// The emulator has no DMA controller; enableDMA() declines.
+#define HAL_HAS_DMA 0
+
+// Bus address of a buffer or register, as the DMA controller sees it.
+// Only meaningful on the Due.
+#define halAddr(p) ((uint32_t)(uintptr_t)(p))
+
+#else
+
+static inline void halAttachPanel(const uint8_t *, uint8_t,
+	uint8_t, uint8_t, uint8_t, uint8_t,
+	uint8_t, uint8_t, uint8_t, uint16_t, uint8_t) { }
+
+#define HAL_HAS_DMA 1
+
+#define halAddr(p) ((uint32_t)(p))
+
+#endif
+
+#endif // _GOODSTUENHAL_H_
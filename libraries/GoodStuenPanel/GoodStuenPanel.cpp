@@ -43,28 +43,63 @@ BSD license, all text above must be included in any redistribution.
  #define SCLKPORT PORTB
  */
 
-#define DEBUG_MODE 1
-
-#define nPlanes 4
- void debugPrint(char* line)
- {
- #if DEBUG_MODE
-	Serial.println(line);
- #endif
- }
- 
- void debugPrint(int line)
- {
- #if DEBUG_MODE
-	Serial.println(line);
- #endif
- }
-// #if DEBUG_MODE
-    // #define debugPrint(...) printf(__VA_ARGS__)
-// #else
-    // #define debugPrint(...)
-// #endif
-//#define debugPrint(...)
+#define MINPLANES 4
+#define DMACH     4 // DMA channel used for scan-out (other libraries tend to use 0-3)
+// Refresh timing (timer ticks) until calibrate() measures it (and the call
+// overhead if it can't):
+#define CALLOVERHEAD   35
+#define LOOPTIME(cols) (600 * ((cols) >> 5))
+// Trace log.  Blocking serial output from inside the refresh interrupt
+// wrecks BCM timing, so trace points just drop fixed-size binary events
+// (id, DWT cycle count, two arguments) into a ring buffer, and loop()
+// prints them at leisure with drainTrace().  It's a single-producer,
+// single-consumer ring: setup-time trace points only run while the
+// refresh interrupt is off, so there's one writer at a time, which owns
+// traceHead; drainTrace() owns traceTail.  Each side publishes its index
+// with a release store after it's done with the slot, and nothing masks
+// interrupts.  When the ring is full, new events are dropped (and
+// counted) rather than waiting.
+#if TRACE_LEVEL > 0
+#define TRACESIZE 64 // Events; must be a power of 2
+
+struct TraceEvent {
+	uint8_t  id;
+	uint32_t time, a, b;
+};
+
+static TraceEvent        traceBuf[TRACESIZE];
+static uint8_t           traceHead, traceTail;
+static volatile uint32_t traceLost;
+
+static void traceEvent(uint8_t id, uint32_t a, uint32_t b) {
+	uint8_t     h = traceHead, // Only this side writes it
+	            n = (h + 1) & (TRACESIZE - 1);
+	TraceEvent *e;
+
+	if (n == __atomic_load_n(&traceTail, __ATOMIC_ACQUIRE)) {
+		traceLost++;
+		return;
+	}
+	e       = &traceBuf[h];
+	e->id   = id;
+	e->time = DWT->CYCCNT;
+	e->a    = a;
+	e->b    = b;
+	__atomic_store_n(&traceHead, n, __ATOMIC_RELEASE); // After the event
+}
+#endif
+
+#if TRACE_LEVEL >= 1
+#define TRACE1(id, a, b) traceEvent(id, a, b)
+#else
+#define TRACE1(id, a, b)
+#endif
+#if TRACE_LEVEL >= 2
+#define TRACE2(id, a, b) traceEvent(id, a, b)
+#else
+#define TRACE2(id, a, b)
+#endif
+
 // The fact that the display driver interrupt stuff is tied to the
 // singular Timer1 doesn't really take well to object orientation with
 // multiple GoodStuenPanel instances.  The solution at present is to
@@ -75,27 +110,77 @@ BSD license, all text above must be included in any redistribution.
 // are even an actual need.
 static GoodStuenPanel *activePanel = NULL;
 
-// Workaround: For some reason when updateDisplay is called from the interrupt handler,
-// the pin values are corrupted. So define them locally for now.
-uint8_t _sclk, _latch, _oe, _a, _b, _c, _d, _r1, _g1, _b1, _r2, _g2, _b2;
+// DWT cycle count on entry to the refresh interrupt, for getStats():
+static volatile uint32_t isrEntry;
+
+// Resolve an Arduino pin number to its SAM3X PIO controller and bitmask,
+// so the interrupt handler can drive pins through PIO_SODR/PIO_CODR
+// directly rather than going through digitalWrite() for every bit.
+static void pinLookup(uint8_t pin, Pio **port, uint32_t *mask) {
+	*port = g_APinDescription[pin].pPort;
+	*mask = g_APinDescription[pin].ulPin;
+}
+
+// Check whether six data pins (R1,G1,B1,R2,G2,B2) are consecutive bits
+// of one PIO controller, in that order.  If so, returns the controller
+// and sets 'bit' to R1's bit number; otherwise returns NULL.
+static Pio *busLookup(const uint8_t *pins, uint8_t *bit) {
+	Pio     *port;
+	uint32_t mask;
+	uint8_t  i;
+
+	pinLookup(pins[0], &port, &mask);
+	for (*bit = 0; (*bit < 32) && !(mask & (1UL << *bit)); (*bit)++);
+	if (*bit > 26) return NULL;
+	for (i = 1; i < 6; i++) {
+		if ((g_APinDescription[pins[i]].pPort != port) ||
+			(g_APinDescription[pins[i]].ulPin != (mask << i))) return NULL;
+	}
+	return port;
+}
 
 // Code common to both the 16x32 and 32x32 constructors:
 void GoodStuenPanel::init(uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_t g2, uint8_t b2,
-	uint8_t rows, uint8_t a, uint8_t b, uint8_t c,
-	uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf) {
+	uint16_t cols, uint8_t rows, uint8_t a, uint8_t b, uint8_t c,
+	uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf, uint8_t planes,
+	uint8_t tilesx, uint8_t tilesy, boolean serpentine, uint8_t chains) {
 
+	nCols = cols; // Columns shifted out per row (32 per chained panel)
 	nRows = rows; // Number of multiplexed rows; actual height is 2X this
 
-	// Allocate and initialize matrix buffer:
-	/*int buffsize = 32 * nRows * 3; // x3 = 3 bytes holds 4 planes "packed"
+	// Arrangement of chained panels on the canvas (see mapPixel()):
+	tilesX = tilesx;
+	tilesY = tilesy;
+	zigzag = serpentine;
+
+	// Parallel chains, each its own copy of the above, stacked vertically.
+	if (chains < 1)         chains = 1;
+	if (chains > MAXCHAINS) chains = MAXCHAINS;
+	nChains = chains;
+
+	// BCM bit depth.  Each plane doubles the time needed for a full
+	// refresh, so more than 8 is pointless; fewer than 4 isn't supported
+	// by the packed buffer layout (plane 0 needs three bytes to live in).
+	if (planes < MINPLANES) planes = MINPLANES;
+	if (planes > MAXPLANES) planes = MAXPLANES;
+	nPlanes = planes;
+	selectGamma(planes);
+
+	// Allocate and initialize matrix buffer.  Each row holds one byte per
+	// column for every plane but plane 0, whose bits are tucked into the
+	// least 2 bits of the first three.  Parallel chains follow one another.
+	chainStride = nCols * nRows * (nPlanes - 1);
+	buffsize    = chainStride * nChains;
 	int allocsize = (dbuf == true) ? (buffsize * 2) : buffsize;
 	if (NULL == (matrixbuff[0] = (uint8_t *)malloc(allocsize))) return;
 	memset(matrixbuff[0], 0, allocsize);
 	// If not double-buffered, both buffers then point to the same address:
-	matrixbuff[1] = (dbuf == true) ? &matrixbuff[0][buffsize] : matrixbuff[0];*/
-    int allocsize = 32 * nRows * 3;
-	if (NULL == (matrixbuff2 = (uint8_t *)malloc(allocsize))) return;
-	memset(matrixbuff2, 0x90, allocsize);
+	matrixbuff[1] = (dbuf == true) ? &matrixbuff[0][buffsize] : matrixbuff[0];
+	nFrames = (dbuf == true) ? 2 : 1;
+	ditherBits = 0;
+	nPhases    = 1;
+	phaseSize  = buffsize;
+	frcphase   = 0;
 
 	// Save pin numbers for use by begin() method later.
 	_r1 = r1;
@@ -104,6 +189,9 @@ void GoodStuenPanel::init(uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_
 	_r2 = r2;
 	_g2 = g2;
 	_b2 = b2;
+	memset(chainpins, 0, sizeof(chainpins)); // Extra chains: not until set
+	chainset = 0;
+	setChainPins(0, r1, g1, b1, r2, g2, b2);
 	_a = a;
 	_b = b;
 	_c = c;
@@ -111,39 +199,79 @@ void GoodStuenPanel::init(uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_
 	_latch = latch;
 	_oe = oe;
 
-	// (also removed from 32x32 constructor)
-	// Look up port registers and pin masks ahead of time,
-	// avoids many slow digitalWrite() calls later. (applicable to arm?)
+	_d = 0; // Set later by 32x32 constructor
+
+	// PIO controllers and pin masks are looked up in begin(), once the
+	// Arduino core has its pin tables set up.
 
 	plane = nPlanes - 1;
 	row = nRows - 1;
 	swapflag = false;
+	swapcallback = NULL;
 	backindex = 0;     // Array index of back buffer
+	frontindex = 1;    // Array index of displayed buffer
+	qhead = qcount = 0;
+	dropped = repeated = 0;
+	dirty = 0;
+	memset(stale, 0, sizeof(stale));
+	fillvalid = false;
+	rxstate = RX_MAGIC0;
+	rxsynced = false;
+	rxframes = rxbytes = rxerrors = 0;
+	rxstart = 0;
+	rowticks = 0;
+	calibrating = false;
+	statson = false;
+	brightness = 255;
+	hwoe = false;
+	onunit = 0;
+	callOverhead = CALLOVERHEAD; // Until begin() measures them
+	loopTime = LOOPTIME(nCols);
+	databus = NULL;
+	dmabuff = dmaback = NULL;
 }
 
 // Constructor for 16x32 panel:
 GoodStuenPanel::GoodStuenPanel(
 	uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_t g2, uint8_t b2,
 	uint8_t a, uint8_t b, uint8_t c,
-	uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf) :
-	Adafruit_GFX(32, 16) {
+	uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf, uint8_t planes,
+	uint8_t tilesx, uint8_t tilesy, boolean serpentine, uint8_t chains) :
+	Adafruit_GFX(32 * tilesx, 16 * tilesy * chains) {
 
-	init(8, r1, g1, b1, r2, g2, b2, a, b, c, sclk, latch, oe, dbuf);
+	init(r1, g1, b1, r2, g2, b2, 32 * tilesx * tilesy, 8, a, b, c,
+		sclk, latch, oe, dbuf, planes, tilesx, tilesy, serpentine, chains);
 }
 
 // Constructor for 32x32 panel:
 GoodStuenPanel::GoodStuenPanel(
 	uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_t g2, uint8_t b2,
 	uint8_t a, uint8_t b, uint8_t c, uint8_t d,
-	uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf) :
-	Adafruit_GFX(32, 32) {
+	uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf, uint8_t planes,
+	uint8_t tilesx, uint8_t tilesy, boolean serpentine, uint8_t chains) :
+	Adafruit_GFX(32 * tilesx, 32 * tilesy * chains) {
 
-	init(16, r1, g1, b1, r2, g2, b2, a, b, c, sclk, latch, oe, dbuf);
+	init(r1, g1, b1, r2, g2, b2, 32 * tilesx * tilesy, 16, a, b, c,
+		sclk, latch, oe, dbuf, planes, tilesx, tilesy, serpentine, chains);
 
 	// Init a few extra 32x32-specific elements:
 	_d = d;
 }
 
+// Constructor for any geometry, used by the GoodStuenMatrix template
+// (width = total columns in a straight chain, rows = multiplexed scan
+// rows):
+GoodStuenPanel::GoodStuenPanel(uint16_t width, uint8_t rows,
+	uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_t g2, uint8_t b2,
+	uint8_t a, uint8_t b, uint8_t c, uint8_t d,
+	uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf, uint8_t planes) :
+	Adafruit_GFX(width, rows * 2) {
+
+	init(r1, g1, b1, r2, g2, b2, width, rows, a, b, c,
+		sclk, latch, oe, dbuf, planes, width / 32, 1, false, 1);
+	_d = d;
+}
+
 // Original GoodStuenPanel library used 3/3/3 color.  Later version used
 // 4/4/4.  Then Adafruit_GFX (core library used across all Adafruit
 // display devices now) standardized on 5/6/5.  The matrix still operates
@@ -171,21 +299,17 @@ uint16_t GoodStuenPanel::Color444(uint8_t r, uint8_t g, uint8_t b) {
 // Demote 8/8/8 to Adafruit_GFX 5/6/5
 // If no gamma flag passed, assume linear color
 uint16_t GoodStuenPanel::Color888(uint8_t r, uint8_t g, uint8_t b) {
-	return ((r & 0xF8) << 11) | ((g & 0xFC) << 5) | (b >> 3);
+	return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
 }
 
 // 8/8/8 -> gamma -> 5/6/5
 uint16_t GoodStuenPanel::Color888(
 	uint8_t r, uint8_t g, uint8_t b, boolean gflag) {
 	if (gflag) { // Gamma-corrected color?
-		r = pgm_read_byte(&gammaVals[r]); // Gamma correction table maps
-		g = pgm_read_byte(&gammaVals[g]); // 8-bit input to 4-bit output
-		b = pgm_read_byte(&gammaVals[b]);
-		return (r << 12) | ((r & 0x8) << 8) | // 4/4/4 -> 5/6/5
-			(g << 7) | ((g & 0xC) << 3) |
-			(b << 1) | (b >> 3);
+		// Tables map 8-bit input straight to 5/6/5 fields
+		return (gammaR[r] << 11) | (gammaG[g] << 5) | gammaB[b];
 	} // else linear (uncorrected) color
-	return ((r & 0xF8) << 11) | ((g & 0xFC) << 5) | (b >> 3);
+	return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
 }
 
 uint16_t GoodStuenPanel::ColorHSV(
@@ -218,25 +342,210 @@ uint16_t GoodStuenPanel::ColorHSV(
 	// Value (brightness) & 16-bit color reduction: similar to above, add 1
 	// to allow shifts, and upgrade to int makes other conversions implicit.
 	v1 = val + 1;
-	if (gflag) { // Gamma-corrected color?
-		r = pgm_read_byte(&gammaVals[(r * v1) >> 8]); // gamma correction table maps
-		g = pgm_read_byte(&gammaVals[(g * v1) >> 8]); // 8-bit input to 4-bit output
-		b = pgm_read_byte(&gammaVals[(b * v1) >> 8]);
+	return Color888((r * v1) >> 8, (g * v1) >> 8, (b * v1) >> 8, gflag);
+}
+
+// Pick the gamma tables for 'depth' bits per component (planes plus any
+// dither bits); see gamma.h.
+void GoodStuenPanel::selectGamma(uint8_t depth) {
+	gammaR = gammaRed[((depth < 5) ? depth : 5) - MINPLANES];
+	gammaG = gammaGreen[((depth < 6) ? depth : 6) - MINPLANES];
+	gammaB = gammaBlue[((depth < 5) ? depth : 5) - MINPLANES];
+}
+
+// Chained panels: the chain is stored as one long row of nCols columns,
+// in the order the data is shifted out.  For a straight chain that is
+// simply left to right as seen from the front, so the panel wired to the
+// Due is the rightmost one.  With more than one row of tiles, the chain
+// continues in the next row of tiles down: either starting over at the
+// left (progressive) or, for serpentine layouts, coming back right to
+// left with those panels mounted upside down, which keeps the ribbon
+// cables short.  Parallel chains are stacked one below the other, each
+// laid out the same way.  Converts unrotated canvas coordinates to
+// chain column and row, and returns the offset of that chain's data in
+// the matrix buffer.
+uint32_t GoodStuenPanel::mapPixel(int16_t &x, int16_t &y) {
+	uint16_t tx, ty, h;
+	uint8_t  k = 0;
+
+	if (nChains > 1) {
+		h  = HEIGHT / nChains;
+		k  = y / h;
+		y -= k * h;
 	}
-	else { // linear (uncorrected) color
-		r = (r * v1) >> 12; // 4-bit results
-		g = (g * v1) >> 12;
-		b = (b * v1) >> 12;
+	if (tilesY > 1) {
+		h  = nRows * 2;
+		tx = x >> 5;
+		ty = y / h;
+		x &= 31;
+		y -= ty * h;
+		if (zigzag && (ty & 1)) { // Reversed row, panels rotated 180
+			tx = tilesX - 1 - tx;
+			x  = 31 - x;
+			y  = h - 1 - y;
+		}
+		x += (ty * tilesX + tx) * 32;
 	}
-	return (r << 12) | ((r & 0x8) << 8) | // 4/4/4 -> 5/6/5
-		(g << 7) | ((g & 0xC) << 3) |
-		(b << 1) | (b >> 3);
+	return k * chainStride;
+}
+
+// Data pins for one of the parallel chains sharing CLK, LAT, OE and the
+// address lines (chain 0 uses the pins passed to the constructor).  Call
+// before begin().  Extra chains are driven through the parallel data bus
+// only, so their six pins must be consecutive bits of the same PIO
+// controller as chain 0's, in R1,G1,B1,R2,G2,B2 order -- e.g. on the Due,
+// pins 33-38 (PC1-PC6), 51-46 (PC12-PC17) and 9-4 (PC21-PC26).  Chains
+// that aren't wired that way stay dark, as do any whose pins were never
+// set or overlap an earlier chain's, CLK, LAT, OE or an address line
+// (and every chain after them).
+void GoodStuenPanel::setChainPins(uint8_t chain,
+	uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_t g2, uint8_t b2) {
+	if (chain >= MAXCHAINS) return;
+	chainpins[chain][0] = r1;
+	chainpins[chain][1] = g1;
+	chainpins[chain][2] = b1;
+	chainpins[chain][3] = r2;
+	chainpins[chain][4] = g2;
+	chainpins[chain][5] = b2;
+	chainset |= 1 << chain;
+}
+
+// Adafruit_GFX uses 16-bit color in 5/6/5 format, while matrix needs
+// one bit per plane.  Expand each component to 8 bits (replicating
+// the top bits into the bottom, so full-on stays full-on), then keep
+// the top nPlanes bits.  For 4 planes this is the same as plucking
+// out RRRRrggggggbbbbb, rrrrrGGGGggbbbbb and rrrrrggggggBBBBb.
+inline void GoodStuenPanel::decodeColor(uint16_t c, uint8_t k,
+	uint8_t &r, uint8_t &g, uint8_t &b) {
+	uint8_t s = 8 - nPlanes - ditherBits;
+
+	r = ((c >> 8) & 0xF8) | (c >> 13);
+	g = ((c >> 3) & 0xFC) | ((c >> 9) & 0x03);
+	b = ((c << 3) & 0xF8) | ((c >> 2) & 0x07);
+	r >>= s;
+	g >>= s;
+	b >>= s;
+	if (ditherBits) phaseLevels(k, r, g, b);
+}
+
+// Phase k shows (v + offset) >> ditherBits.  With the offsets running 0
+// to nPhases-1, the phases add up to exactly v.  Taking them in the
+// order 0,2,1,3 makes half levels alternate every refresh rather than
+// every other one.  Only the brightest levels get clipped.
+inline void GoodStuenPanel::phaseLevels(uint8_t k,
+	uint8_t &r, uint8_t &g, uint8_t &b) {
+	uint16_t top = (1 << nPlanes) - 1;
+
+	if (nPhases == 4) k = ((k & 1) << 1) | (k >> 1);
+	r = ((r + k) >> ditherBits < top) ? ((r + k) >> ditherBits) : top;
+	g = ((g + k) >> ditherBits < top) ? ((g + k) >> ditherBits) : top;
+	b = ((b + k) >> ditherBits < top) ? ((b + k) >> ditherBits) : top;
 }
 
+// The last fill color goes out as its cached native color, below.  Any
+// other is only needed for this one pixel, so rather than encode it
+// for every run and dither phase into the cache (and evict the fill
+// color), its levels are packed straight into the pixel's bytes.
 void GoodStuenPanel::drawPixel(int16_t x, int16_t y, uint16_t c) {
-	uint8_t r, g, b, bit, limit, *ptr;
+	const uint8_t *bits;
+	uint8_t        pat[MAXPLANES - 1], *ptr, r, g, b, j, k, runs = nPlanes - 1;
+	uint16_t       cols = nCols;
 
 	if ((x < 0) || (x >= _width) || (y < 0) || (y >= _height)) return;
+	if (fillvalid && (c == fillcolor)) {
+		drawPixel(x, y, fillnative);
+		return;
+	}
+	ptr = pixelBytes(x, y, &bits);
+	for (k = 0; k < nPhases; k++, ptr += phaseSize) {
+		decodeColor(c, k, r, g, b);
+		packLevels(r, g, b, pat);
+		for (j = 0; j < runs; j++)
+			ptr[j * cols] = (ptr[j * cols] & ~bits[j]) | (pat[j] & bits[j]);
+	}
+}
+
+// -------------------- Native colors --------------------
+
+// Adafruit_GFX colors are 5/6/5, which drawing then has to split back
+// into bitplanes and scatter over the packed buffer.  A GoodStuenColor
+// holds the result of that: for each dither phase and each run of nCols
+// bytes in a row, the bits the color sets.  Encode a color once with
+// nativeColor() or nativeColor888(), and every byte the native drawing
+// calls write is then a single AND/OR.  The 5/6/5 calls do the same
+// through a one-color cache, as Adafruit_GFX tends to draw shapes as
+// many pixels and spans of one color.
+
+// Packed buffer bits owned by the upper and lower half of the panel,
+// per run: planes 1+ in bits 2-4 (upper) and 5-7 (lower), plane 0
+// tucked into bits 0,1 of the first three runs: upper R,G two runs
+// ahead and B one ahead, lower G,B in the first run and R one ahead.
+static const uint8_t halfBits[2][MAXPLANES - 1] = {
+	{ B00011100, B00011101, B00011111, B00011100, B00011100, B00011100, B00011100 },
+	{ B11100011, B11100010, B11100000, B11100000, B11100000, B11100000, B11100000 } };
+
+// Per-run pattern for nPlanes-bit components, both halves at once.
+inline void GoodStuenPanel::packLevels(uint8_t r, uint8_t g, uint8_t b,
+	uint8_t *pattern) {
+	uint8_t j, p, runs = nPlanes - 1; // Local: pattern stores may alias *this
+
+	for (j = 0; j < runs; j++) {
+		p = j + 1; // Run j holds plane j+1
+		pattern[j] = (((r >> p) & 1) | (((g >> p) & 1) << 1) |
+		              (((b >> p) & 1) << 2)) * B00100100; // Bits 2-4 and 5-7
+	}
+	pattern[0] |= (g & 1) | ((b & 1) << 1); // Lower G,B: bits 0,1
+	pattern[1] |= (b & 1) | ((r & 1) << 1); // Upper B: bit 0, lower R: bit 1
+	pattern[2] |= (r & 1) | ((g & 1) << 1); // Upper R,G: bits 0,1
+}
+
+// Encode a 5/6/5 color for this panel.
+void GoodStuenPanel::nativeColor(uint16_t c, GoodStuenColor *nc) {
+	uint8_t r, g, b, k;
+
+	for (k = 0; k < nPhases; k++) {
+		decodeColor(c, k, r, g, b);
+		packLevels(r, g, b, nc->pattern[k]);
+	}
+}
+
+// Encode an 8/8/8 color for this panel.  Linear colors go straight to
+// the panel's depth, keeping any bits 5/6/5 would have dropped; gamma
+// corrected ones go through the gamma tables, which are 5/6/5 already.
+void GoodStuenPanel::nativeColor888(uint8_t r, uint8_t g, uint8_t b,
+	boolean gflag, GoodStuenColor *nc) {
+	uint8_t s = 8 - nPlanes - ditherBits, k, pr, pg, pb;
+
+	if (gflag) {
+		nativeColor(Color888(r, g, b, true), nc);
+		return;
+	}
+	r >>= s;
+	g >>= s;
+	b >>= s;
+	for (k = 0; k < nPhases; k++) {
+		pr = r;
+		pg = g;
+		pb = b;
+		if (ditherBits) phaseLevels(k, pr, pg, pb);
+		packLevels(pr, pg, pb, nc->pattern[k]);
+	}
+}
+
+// Encode c into fillnative, unless it's already there.
+inline void GoodStuenPanel::setFillColor(uint16_t c) {
+	if (fillvalid && (c == fillcolor)) return;
+	nativeColor(c, &fillnative);
+	fillcolor = c;
+	fillvalid = true;
+}
+
+// Rotate and map an on-screen pixel, mark its scan row dirty, and
+// return the address of its byte in the first run of phase 0's image.
+// 'bits' is set to the per-run bits owned by its half of the panel.
+inline uint8_t *GoodStuenPanel::pixelBytes(int16_t x, int16_t y,
+	const uint8_t **bits) {
+	uint32_t base;
 
 	switch (rotation) {
 	case 1:
@@ -252,102 +561,927 @@ void GoodStuenPanel::drawPixel(int16_t x, int16_t y, uint16_t c) {
 		y = HEIGHT - 1 - y;
 		break;
 	}
+	base = mapPixel(x, y);
 
-	// Adafruit_GFX uses 16-bit color in 5/6/5 format, while matrix needs
-	// 4/4/4.  Pluck out relevant bits while separating into R,G,B:
-	r = c >> 12;        // RRRRrggggggbbbbb
-	g = (c >> 7) & 0xF; // rrrrrGGGGggbbbbb
-	b = (c >> 1) & 0xF; // rrrrrggggggBBBBb
+	// Upper half rows are stored in the low bits of each byte, lower half
+	// rows in the high bits of the same bytes.
+	if (y < nRows) {
+		*bits = halfBits[0];
+	} else {
+		*bits = halfBits[1];
+		y    -= nRows;
+	}
+	dirty |= 1UL << y;
+	return &matrixbuff[backindex][base + y * nCols * (nPlanes - 1) + x];
+}
 
-	// Loop counter stuff
-	bit = 2;
-	limit = 1 << nPlanes;//16
+void GoodStuenPanel::drawPixel(int16_t x, int16_t y, const GoodStuenColor &nc) {
+	const uint8_t *bits, *pat;
+	uint8_t       *ptr, j, k, runs = nPlanes - 1;
+	uint16_t       cols = nCols;
 
-	if (y < nRows) {
-		// Data for the upper half of the display is stored in the lower
-		// bits of each byte.
-		ptr = &matrixbuff[backindex][y * WIDTH * (nPlanes - 1) + x]; // Base addr
-		// Plane 0 is a tricky case -- its data is spread about,
-		// stored in least two bits not used by the other planes.                         ptr[64] *(ptr+64)
-		ptr[64] &= ~B00000011;            // Plane 0 R,G mask out in one op
-		if (r & 1) ptr[64] |= B00000001;  // Plane 0 R: 64 bytes ahead, bit 0
-		if (g & 1) ptr[64] |= B00000010;  // Plane 0 G: 64 bytes ahead, bit 1
-		if (b & 1) ptr[32] |= B00000001;  // Plane 0 B: 32 bytes ahead, bit 0
-		else      ptr[32] &= ~B00000001;  // Plane 0 B unset; mask out
-		// The remaining three image planes are more normal-ish.
-		// Data is stored in the high 6 bits so it can be quickly
-		// copied to the DATAPORT register w/6 output lines.
-		for (; bit < limit; bit <<= 1) {
-			*ptr &= ~B00011100;             // Mask out R,G,B in one op
-			if (r & bit) *ptr |= B00000100;  // Plane N R: bit 2
-			if (g & bit) *ptr |= B00001000;  // Plane N G: bit 3
-			if (b & bit) *ptr |= B00010000;  // Plane N B: bit 4
-			ptr += WIDTH;                  // Advance to next bit plane
-		}
-	}
-	else {
-		// Data for the lower half of the display is stored in the upper
-		// bits, except for the plane 0 stuff, using 2 least bits.
-		ptr = &matrixbuff[backindex][(y - nRows) * WIDTH * (nPlanes - 1) + x];
-		*ptr &= ~B00000011;               // Plane 0 G,B mask out in one op
-		if (r & 1)  ptr[32] |= B00000010; // Plane 0 R: 32 bytes ahead, bit 1
-		else       ptr[32] &= ~B00000010; // Plane 0 R unset; mask out
-		if (g & 1) *ptr |= B00000001; // Plane 0 G: bit 0
-		if (b & 1) *ptr |= B00000010; // Plane 0 B: bit 0
-		for (; bit < limit; bit <<= 1) {
-			*ptr &= ~B11100000;             // Mask out R,G,B in one op
-			if (r & bit) *ptr |= B00100000;  // Plane N R: bit 5
-			if (g & bit) *ptr |= B01000000;  // Plane N G: bit 6
-			if (b & bit) *ptr |= B10000000;  // Plane N B: bit 7
-			ptr += WIDTH;                  // Advance to next bit plane
+	if ((x < 0) || (x >= _width) || (y < 0) || (y >= _height)) return;
+	ptr = pixelBytes(x, y, &bits);
+
+	// Once for each dither phase's copy of the image (usually just one),
+	// one byte per run of nCols:
+	for (k = 0; k < nPhases; k++) {
+		pat = nc.pattern[k];
+		for (j = 0; j < runs; j++)
+			ptr[j * cols] = (ptr[j * cols] & ~bits[j]) | (pat[j] & bits[j]);
+		ptr += phaseSize;
+	}
+}
+
+// -------------------- Fast paths --------------------
+
+// Spans and rectangles are written straight into the packed buffer
+// rather than going through drawPixel() a pixel at a time.
+
+// Fill a rectangle in chain coordinates (already clipped, rotated and
+// mapped) with one dither phase's pattern.  'base' is the offset of the
+// chain's data (in that phase's image) in the matrix buffer.
+void GoodStuenPanel::fillChainRect(uint32_t base,
+	int16_t x, int16_t y, int16_t w, int16_t h, const uint8_t *pattern) {
+	uint8_t  *ptr, half, keep, set, j;
+	uint16_t i, rowbytes = nCols * (nPlanes - 1);
+	int16_t  r;
+
+	for (; h > 0; h--, y++) {
+		half = (y >= nRows);
+		r = half ? (y - nRows) : y;
+		dirty |= 1UL << r;
+		ptr = &matrixbuff[backindex][base + r * rowbytes + x];
+		for (j = 0; j < nPlanes - 1; j++, ptr += nCols) {
+			keep = ~halfBits[half][j];
+			set  = pattern[j] & halfBits[half][j];
+			for (i = 0; i < w; i++) ptr[i] = (ptr[i] & keep) | set;
+		}
+	}
+}
+
+void GoodStuenPanel::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+	const GoodStuenColor &nc) {
+	int16_t  t, xa, ya, xb, yb, x0, y0, x1, y1, th;
+	uint32_t base;
+	uint8_t  k;
+
+	// Clip to the canvas
+	if (x < 0) { w += x; x = 0; }
+	if (y < 0) { h += y; y = 0; }
+	if ((x + w) > _width)  w = _width  - x;
+	if ((y + h) > _height) h = _height - y;
+	if ((w <= 0) || (h <= 0)) return;
+
+	// Rotate the rectangle as drawPixel() does its corners
+	switch (rotation) {
+	case 1:
+		t = x; x = WIDTH - y - h; y = t;
+		t = w; w = h; h = t;
+		break;
+	case 2:
+		x = WIDTH - x - w;
+		y = HEIGHT - y - h;
+		break;
+	case 3:
+		t = x; x = y; y = HEIGHT - t - w;
+		t = w; w = h; h = t;
+		break;
+	}
+
+	// Tiles and parallel chains each map to a rectangle of their own
+	// (possibly flipped, on serpentine layouts), so split along panel
+	// boundaries and map opposite corners of each piece.
+	th = nRows * 2;
+	for (ya = y; ya < (y + h); ya = yb) {
+		yb = (ya / th + 1) * th;
+		if (yb > (y + h)) yb = y + h;
+		for (xa = x; xa < (x + w); xa = xb) {
+			xb = (tilesY > 1) ? (((xa >> 5) + 1) << 5) : (x + w);
+			if (xb > (x + w)) xb = x + w;
+			x0 = xa;     y0 = ya;
+			x1 = xb - 1; y1 = yb - 1;
+			base = mapPixel(x0, y0);
+			mapPixel(x1, y1);
+			if (x1 < x0) swap(x0, x1);
+			if (y1 < y0) swap(y0, y1);
+			for (k = 0; k < nPhases; k++) { // Each dither phase's copy
+				fillChainRect(base + k * phaseSize, x0, y0,
+					x1 - x0 + 1, y1 - y0 + 1, nc.pattern[k]);
+			}
+		}
+	}
+}
+
+void GoodStuenPanel::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+	uint16_t c) {
+	setFillColor(c);
+	fillRect(x, y, w, h, fillnative);
+}
+
+void GoodStuenPanel::drawFastHLine(int16_t x, int16_t y, int16_t w,
+	uint16_t c) {
+	fillRect(x, y, w, 1, c);
+}
+
+void GoodStuenPanel::drawFastVLine(int16_t x, int16_t y, int16_t h,
+	uint16_t c) {
+	fillRect(x, y, 1, h, c);
+}
+
+void GoodStuenPanel::drawFastHLine(int16_t x, int16_t y, int16_t w,
+	const GoodStuenColor &nc) {
+	fillRect(x, y, w, 1, nc);
+}
+
+void GoodStuenPanel::drawFastVLine(int16_t x, int16_t y, int16_t h,
+	const GoodStuenColor &nc) {
+	fillRect(x, y, 1, h, nc);
+}
+
+// The pattern is the same byte all along each run of nCols: both halves
+// together cover every bit of it (bits 0,1 of runs past the third
+// aren't used).  So that's one memset per run per row instead of a
+// pixel at a time.
+void GoodStuenPanel::fillScreen(const GoodStuenColor &nc) {
+	uint8_t  *ptr = matrixbuff[backindex], j, k, n;
+	uint16_t r;
+
+	for (n = 0; n < nPhases; n++) {
+		for (k = 0; k < nChains; k++) {
+			for (r = 0; r < nRows; r++) {
+				for (j = 0; j < nPlanes - 1; j++, ptr += nCols)
+					memset(ptr, nc.pattern[n][j], nCols);
+			}
 		}
 	}
+	dirty = ALLROWS;
 }
 
 void GoodStuenPanel::fillScreen(uint16_t c) {
 	if ((c == 0x0000) || (c == 0xffff)) {
 		// For black or white, all bits in frame buffer will be identically
-		// set or unset (regardless of weird bit packing), so it's OK to just
-		// quickly memset the whole thing:
-		memset(matrixbuff[backindex], c, 32 * nRows * 3);
+		// set or unset (regardless of weird bit packing, and in every
+		// dither phase), so it's OK to just quickly memset the whole thing:
+		memset(matrixbuff[backindex], c, buffsize);
+		dirty = ALLROWS;
+	} else {
+		setFillColor(c);
+		fillScreen(fillnative);
+	}
+}
+
+// -------------------- Bulk upload --------------------
+
+// Copy a w x h image of 5/6/5 pixels to the canvas at x,y; 'stride' is
+// the number of pixels from one source row to the next (0: same as w).
+// Meant for content rendered elsewhere, e.g. video frames or effects
+// computed into an array.  Instead of drawPixel()'s read-modify-write
+// of every plane for every pixel, four pixels at a time are decoded
+// into one 32-bit word per component (a whole field of two pixels per
+// operation, at any depth, rather than a table lookup per pixel) and
+// bit-sliced into the packed buffer's four columns of each run (see
+// packGroup()).  Where both rows sharing those bytes are in the image
+// they're packed together and stored outright (packPair()).  Clipped to
+// the canvas.  On a rotated canvas source rows run down the panel's
+// columns, so that case just goes a pixel at a time.
+void GoodStuenPanel::blit(const uint16_t *src, int16_t x, int16_t y,
+	int16_t w, int16_t h, uint16_t stride) {
+	blitRect(src, NULL, x, y, w, h, stride ? stride : w, false);
+}
+
+// Same from 8/8/8 pixels, three bytes each in R,G,B order ('stride'
+// still counts pixels), gamma corrected if gflag.  Linear colors keep
+// any bits 5/6/5 would have dropped, as with nativeColor888().
+void GoodStuenPanel::blit(const uint8_t *src, int16_t x, int16_t y,
+	int16_t w, int16_t h, uint16_t stride, boolean gflag) {
+	blitRect(NULL, src, x, y, w, h, stride ? stride : w, gflag);
+}
+
+void GoodStuenPanel::blitRect(const uint16_t *src565, const uint8_t *src888,
+	int16_t x, int16_t y, int16_t w, int16_t h, uint16_t stride, boolean gflag) {
+	uint8_t        lv[96], half, m, k, i, s = 8 - nPlanes - ditherBits,
+	               phases = nPhases; // Locals: buffer stores may alias *this
+	int16_t        xa, xb, x0, y0, x1, y1, ya, xi, pair;
+	int32_t        off = 0, at, step; // Source pixel indices
+	uint16_t       len, done;
+	uint32_t       base, rowbytes = nCols * (nPlanes - 1), psize = phaseSize,
+	               u[3], l[3];
+	const uint8_t *p;
+	uint8_t       *ptr;
+	GoodStuenColor nc;
+
+	// Clip to the canvas, skipping source pixels to match
+	if (x < 0) { w += x; off -= x; x = 0; }
+	if (y < 0) { h += y; off -= (int32_t)y * stride; y = 0; }
+	if ((x + w) > _width)  w = _width  - x;
+	if ((y + h) > _height) h = _height - y;
+	if ((w <= 0) || (h <= 0)) return;
+
+	if (rotation) {
+		for (ya = 0; ya < h; ya++) {
+			for (xi = 0; xi < w; xi++) {
+				at = off + (int32_t)ya * stride + xi;
+				if (src565) {
+					drawPixel(x + xi, y + ya, src565[at]);
+				} else {
+					p = &src888[at * 3];
+					nativeColor888(p[0], p[1], p[2], gflag, &nc);
+					drawPixel(x + xi, y + ya, nc);
+				}
+			}
+		}
+		return;
 	}
-	else {
-		// Otherwise, need to handle it the long way:
-		Adafruit_GFX::fillScreen(c);
+
+	// Level for each 5-bit (R,B: first 32) and 6-bit (G) field value, as
+	// decodeColor() expands them, for the gamma tables' output and the
+	// last few pixels of a 5/6/5 row:
+	if (src565 || gflag) {
+		for (i = 0; i < 32; i++) lv[i]      = ((i << 3) | (i >> 2)) >> s;
+		for (i = 0; i < 64; i++) lv[32 + i] = ((i << 2) | (i >> 4)) >> s;
+	}
+
+	// Each source row is one row of the chain, but tiled layouts split it
+	// at panel boundaries (as fillRect() does), and on serpentine layouts
+	// some pieces run right to left.  Untiled, a row in the upper half of
+	// a panel and the one nRows further down share the same bytes; if
+	// both are being drawn, they're packed together ('pair' rows apart)
+	// and every bit written outright.
+	for (ya = y; ya < (y + h); ya++) {
+		pair = 0;
+		if (tilesY == 1) {
+			if ((ya % (nRows * 2)) >= nRows) {
+				if ((ya - nRows) >= y) continue; // Went with its upper half
+			} else if ((ya + nRows) < (y + h)) {
+				pair = nRows;
+			}
+		}
+		for (xa = x; xa < (x + w); xa = xb) {
+			xb = (tilesY > 1) ? (((xa >> 5) + 1) << 5) : (x + w);
+			if (xb > (x + w)) xb = x + w;
+			x0 = xa;     y0 = ya;
+			x1 = xb - 1; y1 = ya;
+			base = mapPixel(x0, y0);
+			mapPixel(x1, y1);
+			// Source pixel for the leftmost chain column, and direction
+			at   = off + (int32_t)(ya - y) * stride + (xa - x);
+			step = 1;
+			if (x1 < x0) {
+				at  += xb - 1 - xa;
+				step = -1;
+				swap(x0, x1);
+			}
+			half = (y0 >= nRows);
+			if (half) y0 -= nRows;
+			dirty |= 1UL << y0;
+			ptr = &matrixbuff[backindex][base + y0 * rowbytes + x0];
+			len = x1 - x0 + 1;
+			for (done = 0; done < len; done += 4, ptr += 4, at += step * 4) {
+				// Levels of the next (up to) four pixels, one per byte
+				m = ((len - done) < 4) ? (len - done) : 4;
+				decodeGroup(src565, src888, lv, gflag, at, step, m, u);
+				if (pair) {
+					decodeGroup(src565, src888, lv, gflag,
+						at + (int32_t)pair * stride, step, m, l);
+					for (k = 0; k < phases; k++) // Each dither phase's copy
+						packPair(ptr + k * psize, k, u, l, m);
+				} else {
+					for (k = 0; k < phases; k++)
+						packGroup(ptr + k * psize, half, k, u, m);
+				}
+			}
+		}
+	}
+}
+
+// Levels of one 5/6/5 field ('bits' wide, 'pos' up) of two pixels at
+// once, one in each 16-bit half of c, expanded as decodeColor() does:
+// the top 'depth' bits, with the field's top bits repeated below it
+// where it's narrower than that.
+static inline __attribute__((always_inline))
+uint32_t fieldLevels(uint32_t c, uint8_t pos, uint8_t bits, uint8_t depth) {
+	uint32_t v = (c >> pos) & (((1UL << bits) - 1) * 0x00010001);
+
+	v = (depth <= bits) ? (v >> (bits - depth)) :
+		((v << (depth - bits)) | (v >> (bits * 2 - depth)));
+	return v & (((1UL << depth) - 1) * 0x00010001); // Lose what crossed over
+}
+
+// Decode m (up to four) source pixels from index 'at', 'step' apart, to
+// one level per byte of w[0] (R), w[1] (G) and w[2] (B).  A full group of
+// 5/6/5 pixels is two per word, 0 and 2, 1 and 3, which then interleave
+// into bytes 0-3; linear 8/8/8 is just a shift per component.  Gamma
+// corrected, and the last few pixels of a row, go through 'lv' (see
+// blitRect()).
+inline __attribute__((always_inline))
+void GoodStuenPanel::decodeGroup(const uint16_t *src565,
+	const uint8_t *src888, const uint8_t *lv, boolean gflag,
+	int32_t at, int32_t step, uint8_t m, uint32_t *w) {
+	uint8_t        depth = nPlanes + ditherBits, s = 8 - depth, i;
+	uint32_t       c02, c13, c;
+	const uint8_t *p;
+
+	w[0] = w[1] = w[2] = 0;
+	if (src565 && (m == 4)) {
+		c02  = src565[at] | ((uint32_t)src565[at + step * 2] << 16);
+		c13  = src565[at + step] | ((uint32_t)src565[at + step * 3] << 16);
+		w[0] = fieldLevels(c02, 11, 5, depth) | (fieldLevels(c13, 11, 5, depth) << 8);
+		w[1] = fieldLevels(c02,  5, 6, depth) | (fieldLevels(c13,  5, 6, depth) << 8);
+		w[2] = fieldLevels(c02,  0, 5, depth) | (fieldLevels(c13,  0, 5, depth) << 8);
+	} else if (src565) {
+		for (i = 0; i < m; i++, at += step) {
+			c     = src565[at];
+			w[0] |= (uint32_t)lv[c >> 11] << (i * 8);
+			w[1] |= (uint32_t)lv[32 + ((c >> 5) & 0x3F)] << (i * 8);
+			w[2] |= (uint32_t)lv[c & 0x1F] << (i * 8);
+		}
+	} else if (gflag) {
+		for (i = 0; i < m; i++, at += step) {
+			p     = &src888[at * 3];
+			w[0] |= (uint32_t)lv[gammaR[p[0]]] << (i * 8);
+			w[1] |= (uint32_t)lv[32 + gammaG[p[1]]] << (i * 8);
+			w[2] |= (uint32_t)lv[gammaB[p[2]]] << (i * 8);
+		}
+	} else {
+		for (i = 0; i < m; i++, at += step) {
+			p     = &src888[at * 3];
+			w[0] |= (uint32_t)p[0] << (i * 8);
+			w[1] |= (uint32_t)p[1] << (i * 8);
+			w[2] |= (uint32_t)p[2] << (i * 8);
+		}
+		c    = (0xFF >> s) * 0x01010101;
+		w[0] = (w[0] >> s) & c;
+		w[1] = (w[1] >> s) & c;
+		w[2] = (w[2] >> s) & c;
+	}
+}
+
+// With dithering, phase k's share of each level in rw, gw and bw, clipped
+// to the top level as phaseLevels() does (here it's never over by more
+// than 1, and nothing carries from one byte to the next).
+inline __attribute__((always_inline))
+void GoodStuenPanel::phaseWords(uint8_t k,
+	uint32_t &rw, uint32_t &gw, uint32_t &bw) {
+	const uint32_t ones = 0x01010101;
+	uint8_t        d = ditherBits;
+	uint32_t       keep = (0xFF >> d) * ones;
+
+	if (nPhases == 4) k = ((k & 1) << 1) | (k >> 1);
+	rw  = ((rw + k * ones) >> d) & keep;
+	gw  = ((gw + k * ones) >> d) & keep;
+	bw  = ((bw + k * ones) >> d) & keep;
+	rw -= (rw >> nPlanes) & ones;
+	gw -= (gw >> nPlanes) & ones;
+	bw -= (bw >> nPlanes) & ones;
+}
+
+// Bit-slice m (up to four) pixels into the packed buffer at ptr, the
+// first of their columns in a row, for dither phase k.  w holds one
+// pixel's level per byte for each component, and so do the buffer's
+// runs of columns; so a shift and mask per component pulls one plane's
+// bits out of all four pixels at once, multiplying by B00100100 copies
+// them to both halves' bit positions (the same pattern as packLevels()),
+// and one AND/OR merges in the half being drawn.
+inline __attribute__((always_inline))
+void GoodStuenPanel::packGroup(uint8_t *ptr, uint8_t half, uint8_t k,
+	const uint32_t *w, uint8_t m) {
+	const uint32_t ones = 0x01010101;
+	uint32_t rw = w[0], gw = w[1], bw = w[2], p0[3], pat, mask, dst;
+	uint8_t  j, b, runs = nPlanes - 1;
+	uint16_t cols = nCols; // Locals: buffer stores may alias *this
+
+	if (ditherBits) phaseWords(k, rw, gw, bw);
+	// Plane 0, tucked into the first three runs (see halfBits)
+	p0[0] = (gw & ones) | ((bw & ones) << 1); // Lower G,B
+	p0[1] = (bw & ones) | ((rw & ones) << 1); // Upper B, lower R
+	p0[2] = (rw & ones) | ((gw & ones) << 1); // Upper R,G
+	for (j = 0; j < runs; j++, ptr += cols) {
+		rw >>= 1; // Plane j+1 to bit 0 of each byte
+		gw >>= 1;
+		bw >>= 1;
+		pat = ((rw & ones) | ((gw & ones) << 1) | ((bw & ones) << 2)) * B00100100;
+		if (j < 3) pat |= p0[j];
+		if (m == 4) {
+			mask = halfBits[half][j] * ones;
+			memcpy(&dst, ptr, 4); // Unaligned is fine on the Cortex-M3
+			dst = (dst & ~mask) | (pat & mask);
+			memcpy(ptr, &dst, 4);
+		} else {
+			// Last few columns: bytewise, touching nothing past them
+			for (b = 0; b < m; b++, pat >>= 8)
+				ptr[b] = (ptr[b] & ~halfBits[half][j]) | (pat & halfBits[half][j]);
+		}
 	}
 }
 
-// Return address of back buffer -- can then load/store data directly
+// Same for an upper half row (u) and the lower half row sharing its
+// bytes (l).  Between them they own every bit of each byte (bits 0,1 of
+// runs past the third aren't used), so the bytes are just stored.
+inline __attribute__((always_inline))
+void GoodStuenPanel::packPair(uint8_t *ptr, uint8_t k,
+	const uint32_t *u, const uint32_t *l, uint8_t m) {
+	const uint32_t ones = 0x01010101;
+	uint32_t ur = u[0], ug = u[1], ub = u[2], lr = l[0], lg = l[1], lb = l[2],
+	         p0[3], pat;
+	uint8_t  j, b, runs = nPlanes - 1;
+	uint16_t cols = nCols;
+
+	if (ditherBits) {
+		phaseWords(k, ur, ug, ub);
+		phaseWords(k, lr, lg, lb);
+	}
+	p0[0] = (lg & ones) | ((lb & ones) << 1); // Lower G,B
+	p0[1] = (ub & ones) | ((lr & ones) << 1); // Upper B, lower R
+	p0[2] = (ur & ones) | ((ug & ones) << 1); // Upper R,G
+	for (j = 0; j < runs; j++, ptr += cols) {
+		ur >>= 1; ug >>= 1; ub >>= 1;
+		lr >>= 1; lg >>= 1; lb >>= 1;
+		pat = (((ur & ones) | ((ug & ones) << 1) | ((ub & ones) << 2)) << 2) |
+		      (((lr & ones) | ((lg & ones) << 1) | ((lb & ones) << 2)) << 5);
+		if (j < 3) pat |= p0[j];
+		if (m == 4) {
+			memcpy(ptr, &pat, 4);
+		} else {
+			for (b = 0; b < m; b++, pat >>= 8) ptr[b] = pat;
+		}
+	}
+}
+
+// Return address of back buffer -- can then load/store data directly.
+// Every row is then assumed changed.  With dithering, the buffer holds
+// one packed image per phase, phaseSize bytes apart.
 uint8_t *GoodStuenPanel::backBuffer() {
+	dirty = ALLROWS;
 	return matrixbuff[backindex];
 }
 
+// Bytes in the back buffer: every chain, and every dither phase.
+uint32_t GoodStuenPanel::bufferSize(void) {
+	return buffsize;
+}
+
+// -------------------- Dirty rows --------------------
+
+// Bit r set = scan row r (both halves, all chains) drawn into since the
+// back buffer was last presented, or since clearDirty().  Lets anything
+// consuming the buffer skip unchanged rows.
+uint32_t GoodStuenPanel::dirtyRows(void) {
+	return dirty;
+}
+
+// Start tracking changes afresh, e.g. once a single-buffered display's
+// rows have been streamed out elsewhere.  Swap copies aren't affected.
+void GoodStuenPanel::clearDirty(void) {
+	uint8_t i;
+
+	for (i = 0; i < nFrames; i++) {
+		if (i != backindex) stale[i] |= dirty;
+	}
+	dirty = 0;
+}
+
+// The back buffer is about to be presented.  Each buffer tracks the rows
+// in which it may differ from the newest presented frame; every other
+// buffer now also differs wherever the back buffer did from the previous
+// frame, or was drawn into since.
+void GoodStuenPanel::foldDirty(void) {
+	uint8_t  i;
+	uint32_t d = dirty | stale[backindex];
+
+	for (i = 0; i < nFrames; i++) {
+		if (i != backindex) stale[i] |= d;
+	}
+	stale[backindex] = 0;
+	dirty = 0;
+}
+
+// Copy the given scan rows (for every chain and dither phase) from one
+// packed buffer to another, in as few runs as possible.
+void GoodStuenPanel::copyRows(uint8_t *dst, const uint8_t *src, uint32_t rows) {
+	uint8_t  r, n, k;
+	uint16_t rowbytes = nCols * (nPlanes - 1);
+	uint32_t offset;
+
+	if (!rows) return;
+	if ((rows & ALLROWS) == ALLROWS) {
+		memcpy(dst, src, buffsize);
+		return;
+	}
+	for (r = 0; r < nRows; r += n) {
+		for (n = 0; ((r + n) < nRows) && (rows & (1UL << (r + n))); n++);
+		if (n == 0) {
+			n = 1;
+			continue;
+		}
+		// Phases repeat the chains' layout, so count them as more chains
+		for (k = 0; k < nChains * nPhases; k++) {
+			offset = k * chainStride + r * rowbytes;
+			memcpy(&dst[offset], &src[offset], n * rowbytes);
+		}
+	}
+}
+
 // For smooth animation -- drawing always takes place in the "back" buffer;
-// this method pushes it to the "front" for display.  Passing "true", the
-// updated display contents are then copied to the new back buffer and can
-// be incrementally modified.  If "false", the back buffer then contains
-// the old front buffer contents -- your code can either clear this or
-// draw over every pixel.  (No effect if double-buffering is not enabled.)
+// this method pushes it to the "front" for display.  The swap itself
+// happens in the interrupt handler at the end of a complete refresh, so
+// the display doesn't 'tear'; this call returns right away.  Until
+// swapPending() goes false (or the onSwap() callback runs), the back
+// buffer still belongs to the frame just submitted and must not be drawn
+// into -- but anything else needed for the next frame can get underway.
+// With a frame queue (see enableQueue()) this is presentFrame().
+// (No effect if double-buffering is not enabled.)
+void GoodStuenPanel::requestSwap(void) {
+	presentFrame();
+}
+
+// True while a swap requested by requestSwap() is still waiting for the
+// end of the current refresh, or with a frame queue, while any presented
+// frame has yet to reach the display.
+boolean GoodStuenPanel::swapPending(void) {
+	return (nFrames > 2) ? (qcount > 0) : swapflag;
+}
+
+// Function to be called once a requested swap has taken place, e.g. to
+// kick off drawing the next frame.  Runs in interrupt context, so keep
+// it brief.  NULL to remove.
+void GoodStuenPanel::onSwap(void (*callback)(void)) {
+	swapcallback = callback;
+}
+
+// Blocking swap, as before.  Passing "true", the updated display contents
+// are then copied to the new back buffer and can be incrementally
+// modified.  If "false", the back buffer then contains the old front
+// buffer contents -- your code can either clear this or draw over every
+// pixel.  Spins on the flag rather than sleeping in delay(1), so returns
+// as soon as the frame ends; use requestSwap() to avoid waiting at all.
+// With a frame queue, only waits if the queue is full.
 void GoodStuenPanel::swapBuffers(boolean copy) {
-	if (matrixbuff[0] != matrixbuff[1]) {
-		// To avoid 'tearing' display, actual swap takes place in the interrupt
-		// handler, at the end of a complete screen refresh cycle.
-		swapflag = true;                  // Set flag here, then...
-		while (swapflag == true) delay(1); // wait for interrupt to clear it
+	if (nFrames > 2) {
+		while (!presentFrame()); // FRAME_FIFO queue full: wait for a slot
+		if (copy == true) syncBackBuffer();
+	} else if (matrixbuff[0] != matrixbuff[1]) {
+		requestSwap();
+		while (swapflag == true); // Wait for interrupt to clear it
 
 		// GS: After you swap back buffer to front, if you want to start again
 		// with the previous buffer contents (instead of having to redraw the whole thing)
 		// then this will copy the old contents to the new back buffer
-		if (copy == true)
-			memcpy(matrixbuff[backindex], matrixbuff[1 - backindex], 32 * nRows * 3);
+		// (just the rows that differ)
+		if (copy == true) syncBackBuffer();
+	}
+}
+
+// Bring the back buffer up to date with the newest presented frame,
+// copying only the rows that differ.  With plain double buffering, only
+// once that frame's swap is done.
+void GoodStuenPanel::syncBackBuffer(void) {
+	if (nFrames > 2) {
+		copyRows(matrixbuff[backindex], matrixbuff[lastindex], stale[backindex]);
+	} else if (nFrames == 2) {
+		copyRows(matrixbuff[backindex], matrixbuff[1 - backindex], stale[backindex]);
+	}
+	stale[backindex] = 0;
+}
+
+// -------------------- Frame queue --------------------
+
+// Instead of front and back buffers only, keep 'frames' (3 to MAXFRAMES)
+// packed buffers: one on display, one being drawn, and the rest a queue
+// of finished frames waiting for the end of a refresh.  A render loop
+// faster than the refresh then doesn't stall on every frame, and a slower
+// one still only ever hands over complete frames.  'policy' is either
+// FRAME_FIFO, presenting every frame in order (presentFrame() fails while
+// the queue is full), or FRAME_LATEST, always presenting the newest and
+// recycling stale ones (presentFrame() never fails; frames overtaken
+// before reaching the display count as dropped).  All buffers come from
+// one block, grown from the existing one.  Call before begin().  Returns
+// false if it's too late for that or there's not enough RAM.
+boolean GoodStuenPanel::enableQueue(uint8_t frames, uint8_t policy) {
+	uint8_t *buf, i;
+
+	if (activePanel == this) return false; // Interrupt already running
+	if (frames < 3)         frames = 3;
+	if (frames > MAXFRAMES) frames = MAXFRAMES;
+	if (NULL == (buf = (uint8_t *)realloc(matrixbuff[0], frames * buffsize)))
+		return false;
+	// Contents of the original back buffer are kept
+	memset(&buf[buffsize], 0, (frames - 1) * buffsize);
+	for (i = 0; i < frames; i++) matrixbuff[i] = &buf[i * buffsize];
+	nFrames    = frames;
+	qpolicy    = policy;
+	backindex  = 0;
+	frontindex = 1;
+	qhead = qcount = 0;
+	dirty = ALLROWS; // Nothing presented yet; assume nothing matches
+	for (i = 0; i < MAXFRAMES; i++) stale[i] = ALLROWS;
+	return true;
+}
+
+// Hand the back buffer over for display and carry on drawing in a free
+// one.  Never waits: returns false if the frame can't be taken yet (a
+// double-buffer swap still pending, or a full FRAME_FIFO queue), in which
+// case the back buffer is unchanged and the caller can try again later.
+boolean GoodStuenPanel::presentFrame(void) {
+	uint8_t i, j;
+
+	if (nFrames <= 2) {
+		// Plain double buffering (or none at all)
+		if (matrixbuff[0] == matrixbuff[1]) return true;
+		if (swapflag == true) return false;
+		foldDirty();
+		// DMA scan-out: the spare word buffer isn't being read; fill it
+		// from the new frame for the interrupt to switch to with it.
+		if (dmaback) encodeFrame(dmaback, matrixbuff[backindex], ALLROWS);
+		swapflag = true;
+		return true;
 	}
+
+	// The interrupt changes the queue too; keep it out for these few lines.
+	noInterrupts();
+	if (qcount >= (nFrames - 2)) {
+		if (qpolicy == FRAME_FIFO) {
+			interrupts();
+			return false;
+		}
+		qhead = (qhead + 1) & (MAXFRAMES - 1); // Recycle oldest queued frame
+		qcount--;
+		dropped++;
+	}
+	foldDirty();
+	fqueue[(qhead + qcount) & (MAXFRAMES - 1)] = backindex;
+	qcount++;
+	lastindex = backindex;
+	// New back buffer: any one neither on display nor queued
+	for (i = 0; i < nFrames; i++) {
+		if (i == frontindex) continue;
+		for (j = 0; (j < qcount) &&
+			(fqueue[(qhead + j) & (MAXFRAMES - 1)] != i); j++);
+		if (j == qcount) break;
+	}
+	backindex = i;
+	interrupts();
+	return true;
+}
+
+// -------------------- Frame streaming --------------------
+
+// Content rendered on a PC can be sent ready-packed, in the layout
+// backBuffer() has for this panel's geometry, planes and dithering.
+// Each STREAM_RAW frame's payload is that whole buffer (sizes other
+// than bufferSize() are skipped), read straight into the back buffer.
+// A STREAM_DELTA frame only carries what changed since the frame
+// before it, which the back buffer is first brought up to date with:
+// a 32-bit mask of the scan rows that changed (as dirtyRows()), then
+// for each of those rows in turn, runs covering all of its bytes in
+// every chain and dither phase, in buffer order (buffsize / nRows
+// bytes).  Each run is an op byte:
+//   0x00-0x7F  n+1 bytes unchanged
+//   0x80-0xBF  n+1 bytes follow, to copy in ('n' = low 6 bits)
+//   0xC0-0xFF  the next byte, repeated n+1 times
+// Deltas are skipped until a raw frame has been received, and again
+// after one turns out malformed.  Call from loop() as often as
+// possible; never waits for data, only takes what 'in' (e.g.
+// SerialUSB) already has.  Until a frame can be presented, and with
+// plain double buffering until its swap is done, the rest of the
+// stream is left waiting in 'in'.  Returns true when a frame has just
+// been presented.  The back buffer isn't for drawing into while frames
+// are coming in.
+boolean GoodStuenPanel::receiveFrames(Stream &in) {
+	uint8_t *ptr;
+	uint32_t room;
+	int32_t  n;
+	int      c;
+
+	for (;;) {
+		if (rxstate == RX_PRESENT) {
+			if (!presentFrame()) return false; // Try again next call
+			rxframes++;
+			rxstate = RX_MAGIC0;
+			return true;
+		}
+		if ((n = in.available()) <= 0) return false;
+
+		if ((rxstate >= RX_PAYLOAD) && (rxstate < RX_SKIP)) {
+			if (!rxready) {
+				// About to touch the back buffer for this frame
+				if ((nFrames == 2) && swapflag) return false; // Still busy
+				if (rxtype == STREAM_RAW) dirty = ALLROWS;
+				else                      syncBackBuffer();
+				rxready = true;
+			}
+			if (!rxleft) { // Delta payload too short for its runs
+				rxAbort();
+				continue;
+			}
+		}
+		if (rxstate == RX_PAYLOAD) {
+			if ((uint32_t)n > rxleft) n = rxleft;
+			n = in.readBytes(&matrixbuff[backindex][rxpos], n);
+			rxpos   += n;
+			rxleft  -= n;
+			rxbytes += n;
+			if (!rxleft) {
+				rxsynced = true;
+				rxstate  = RX_PRESENT;
+			}
+			continue;
+		}
+		if (rxstate == RX_LITERAL) {
+			ptr = rxPointer(room);
+			if ((uint32_t)n > rxleft) n = rxleft;
+			if ((uint32_t)n > room)   n = room;
+			if (n > rxrun)            n = rxrun;
+			n = in.readBytes(ptr, n);
+			rxpos   += n;
+			rxrun   -= n;
+			rxleft  -= n;
+			rxbytes += n;
+			if (!rxrun) nextRun();
+			continue;
+		}
+		if (rxstate == RX_SKIP) {
+			for (; (n > 0) && rxleft; n--, rxleft--, rxbytes++) in.read();
+			if (!rxleft) rxstate = RX_MAGIC0;
+			continue;
+		}
+
+		// Headers, row masks and run ops, a byte at a time; anything
+		// before 'G','S' is dropped
+		c = in.read();
+		rxbytes++;
+		if (rxstate > RX_PAYLOAD) rxleft--;
+		switch (rxstate) {
+		case RX_MAGIC0:
+			if (c == 'G') rxstate = RX_MAGIC1;
+			break;
+		case RX_MAGIC1:
+			rxstate = (c == 'S') ? RX_TYPE : (c == 'G') ? RX_MAGIC1 : RX_MAGIC0;
+			break;
+		case RX_TYPE:
+			rxtype  = c;
+			rxleft  = 0;
+			rxstate = RX_LENGTH;
+			break;
+		case RX_LENGTH:
+		case RX_LENGTH + 1:
+		case RX_LENGTH + 2:
+		case RX_LENGTH + 3:
+			rxleft |= (uint32_t)c << ((rxstate - RX_LENGTH) * 8);
+			if (++rxstate < RX_PAYLOAD) break;
+			rxpos   = 0;
+			rxready = false;
+			if ((rxtype == STREAM_RAW) && (rxleft == buffsize)) {
+				rxstate = RX_PAYLOAD;
+			} else if ((rxtype == STREAM_DELTA) && rxsynced && (rxleft >= 4)) {
+				rxmask  = 0;
+				rxstate = RX_MASK;
+			} else {
+				rxerrors++;
+				rxstate = rxleft ? RX_SKIP : RX_MAGIC0;
+			}
+			break;
+		case RX_MASK:
+		case RX_MASK + 1:
+		case RX_MASK + 2:
+		case RX_MASK + 3:
+			rxmask |= (uint32_t)c << ((rxstate - RX_MASK) * 8);
+			if (++rxstate < RX_OP) break;
+			if (rxmask >> nRows) { // Rows the panel doesn't have
+				rxAbort();
+				break;
+			}
+			dirty |= rxmask;
+			rxpos  = buffsize / nRows; // As if at the end of a row
+			nextRun();
+			break;
+		case RX_OP:
+			rxrun = (c < 0x80) ? (c + 1) : ((c & 0x3F) + 1);
+			if (rxrun > ((buffsize / nRows) - rxpos)) { // Past the row's end
+				rxAbort();
+			} else if (c < 0x80) {
+				rxpos += rxrun;
+				nextRun();
+			} else {
+				rxstate = (c < 0xC0) ? RX_LITERAL : RX_VALUE;
+			}
+			break;
+		case RX_VALUE:
+			while (rxrun) {
+				ptr = rxPointer(room);
+				if (room > rxrun) room = rxrun;
+				memset(ptr, c, room);
+				rxpos += room;
+				rxrun -= room;
+			}
+			nextRun();
+			break;
+		}
+	}
+}
+
+// Where byte rxpos of scan row rxrow's run data (which runs through
+// every chain and phase in turn) is in the back buffer, and how many
+// bytes from there on are contiguous.
+uint8_t *GoodStuenPanel::rxPointer(uint32_t &room) {
+	uint32_t rowbytes = nCols * (nPlanes - 1), k = rxpos / rowbytes;
+
+	room = rowbytes - (rxpos - k * rowbytes);
+	return &matrixbuff[backindex][k * chainStride + rxrow * rowbytes +
+		(rxpos - k * rowbytes)];
+}
+
+// A delta run is done: on to the next run in this row, the next row
+// with changes, or the end of the frame.
+void GoodStuenPanel::nextRun(void) {
+	if (rxpos < (buffsize / nRows)) {
+		rxstate = RX_OP;
+	} else if (rxmask) {
+		rxrow   = __builtin_ctz(rxmask); // Lowest row left
+		rxmask &= rxmask - 1;
+		rxpos   = 0;
+		rxstate = RX_OP;
+	} else if (rxleft) {
+		rxAbort(); // Payload longer than its runs
+	} else {
+		rxstate = RX_PRESENT;
+	}
+}
+
+// Malformed delta: skip what's left of it.  The back buffer may be half
+// updated, so deltas wait for the next raw frame.
+void GoodStuenPanel::rxAbort(void) {
+	rxerrors++;
+	rxsynced = false;
+	rxstate  = rxleft ? RX_SKIP : RX_MAGIC0;
+}
+
+// Frames and bytes received since start-up (or the last reset), and
+// their rates.
+void GoodStuenPanel::getStreamStats(GoodStuenStreamStats *stats, boolean reset) {
+	stats->frames  = rxframes;
+	stats->bytes   = rxbytes;
+	stats->errors  = rxerrors;
+	stats->elapsed = millis() - rxstart;
+	stats->fps     = stats->elapsed ?
+		(uint16_t)(((uint64_t)rxframes * 1000) / stats->elapsed) : 0;
+	stats->bps     = stats->elapsed ?
+		(uint32_t)(((uint64_t)rxbytes * 1000) / stats->elapsed) : 0;
+	if (reset) {
+		rxframes = rxbytes = rxerrors = 0;
+		rxstart  = millis();
+	}
+}
+
+// -------------------- Temporal dithering --------------------
+
+// Frame rate control: show 'bits' (1 or 2) more bits of color depth than
+// there are BCM planes, at no cost in refresh time.  Each frame buffer
+// holds 2^bits packed images, in which a color's extra low bits round
+// its level up in that many of the phases.  The interrupt moves on to
+// the next image every refresh, and the LEDs average them out, so
+// gradients and dim fades lose most of their banding.  This only works
+// as far as the 5/6/5 color carries the extra bits, i.e. up to 6 bits
+// in total.  It costs RAM and drawing time per phase, and each
+// phase's image refreshes at refreshRate() / 2^bits, so 1 bit is the
+// safe choice for flicker.  Clears the display; call before begin().
+// Not available with DMA scan-out.  0 turns it back off.  Returns false if it's too late or
+// there's not enough RAM.
+boolean GoodStuenPanel::enableDither(uint8_t bits) {
+	uint8_t *buf, i;
+	uint32_t size;
+
+	if (activePanel == this) return false; // Interrupt already running
+	if (bits > 2) bits = 2;
+	if ((nPlanes + bits) > 6) bits = (nPlanes < 6) ? (6 - nPlanes) : 0;
+	size = phaseSize << bits;
+	if (NULL == (buf = (uint8_t *)realloc(matrixbuff[0], nFrames * size)))
+		return false;
+	memset(buf, 0, nFrames * size);
+	for (i = 0; i < nFrames; i++) matrixbuff[i] = &buf[i * size];
+	if (nFrames == 1) matrixbuff[1] = buf; // Single-buffered: both the same
+	ditherBits = bits;
+	nPhases    = 1 << bits;
+	buffsize   = size;
+	frcphase   = 0;
+	fillvalid  = false;
+	selectGamma(nPlanes + bits);
+	dirty = ALLROWS;
+	for (i = 0; i < MAXFRAMES; i++) stale[i] = ALLROWS;
+	return true;
+}
+
+// Frames presented but overtaken before ever being displayed (FRAME_LATEST
+// only), and refreshes that showed the same frame again because nothing
+// new was queued.
+uint32_t GoodStuenPanel::droppedFrames(void) {
+	return dropped;
+}
+
+uint32_t GoodStuenPanel::repeatedFrames(void) {
+	return repeated;
 }
 
-// Dump display contents to the Serial Monitor, adding some formatting to
-// simplify copy-and-paste of data as a PROGMEM-embedded image for another
-// sketch.  If using multiple dumps this way, you'll need to edit the
-// output to change the 'img' name for each.  Data can then be loaded
-// back into the display using a pgm_read_byte() loop.
 void GoodStuenPanel::dumpMatrix(void) {
 
 	/*int i, buffsize = 32 * nRows * 3;
@@ -369,117 +1503,397 @@ void GoodStuenPanel::dumpMatrix(void) {
 }
 
 void GoodStuenPanel::begin(void) {
+	uint8_t  bit, i;
+	uint32_t busbits; // Port bits taken by control lines and earlier chains
 
-	backindex = 0;                         // Back buffer
-	//buffptr = matrixbuff[1 - backindex]; // -> front buffer
-    buffptr = matrixbuff2;
+	NVIC_DisableIRQ(TC0_IRQn); // If begun again; startTimerCounter() restarts it
+	buffptr = matrixbuff[frontindex];     // -> front buffer
 	activePanel = this;                      // For interrupt hander
 
-	debugPrint("Oh, goodstuen hah? begin!");
+#if TRACE_LEVEL > 0
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; // DWT timestamps
+	DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+	TRACE1(TRACE_BEGIN, nCols, nRows);
+
+	// Look up port registers and pin masks ahead of time,
+	// avoids many slow digitalWrite() calls later.
+	pinLookup(_r1, &r1port, &r1pin);
+	pinLookup(_g1, &g1port, &g1pin);
+	pinLookup(_b1, &b1port, &b1pin);
+	pinLookup(_r2, &r2port, &r2pin);
+	pinLookup(_g2, &g2port, &g2pin);
+	pinLookup(_b2, &b2port, &b2pin);
+	pinLookup(_sclk, &sclkport, &sclkpin);
+	pinLookup(_latch, &latport, &latpin);
+	pinLookup(_oe, &oeport, &oepin);
+	pinLookup(_a, &addraport, &addrapin);
+	pinLookup(_b, &addrbport, &addrbpin);
+	pinLookup(_c, &addrcport, &addrcpin);
+
+	// OE on pin 2 (PB25) is TIOA0, the refresh timer's own waveform
+	// output, which can then switch the LEDs off at the brightness
+	// cutoff in hardware.  Elsewhere that takes an extra interrupt.
+	hwoe = (oeport == PIOB) && (oepin == PIO_PB25B_TIOA0);
+	if (!hwoe) onunit = 0; // setExactTiming() before begin() can't work
 
 	// Enable all comm & address pins as outputs, set default states:
-	pinMode(_r1, OUTPUT); digitalWrite(_r1, LOW);
-	pinMode(_g1, OUTPUT); digitalWrite(_g1, LOW);
-	pinMode(_b1, OUTPUT); digitalWrite(_b1, LOW);
-	pinMode(_r2, OUTPUT); digitalWrite(_r2, LOW);
-	pinMode(_g2, OUTPUT); digitalWrite(_g2, LOW);
-	pinMode(_b2, OUTPUT); digitalWrite(_b2, LOW);
-	pinMode(_sclk, OUTPUT); digitalWrite(_sclk, LOW);
-	pinMode(_latch, OUTPUT); digitalWrite(_latch, LOW);
-	pinMode(_oe, OUTPUT); digitalWrite(_oe, LOW);     // LOW (enable output)
-	pinMode(_a, OUTPUT); digitalWrite(_a, LOW);
-	pinMode(_b, OUTPUT); digitalWrite(_b, LOW);
-	pinMode(_c, OUTPUT); digitalWrite(_c, LOW);
-    
-    /*
-    for(int i=2; i <=13; i++)
-    {
-        Serial.println(i);
-        digitalWrite(i, HIGH);
-        delay(5000);
-        digitalWrite(i, LOW);
-    }
-    */
+	pinMode(_r1, OUTPUT); r1port->PIO_CODR = r1pin;
+	pinMode(_g1, OUTPUT); g1port->PIO_CODR = g1pin;
+	pinMode(_b1, OUTPUT); b1port->PIO_CODR = b1pin;
+	pinMode(_r2, OUTPUT); r2port->PIO_CODR = r2pin;
+	pinMode(_g2, OUTPUT); g2port->PIO_CODR = g2pin;
+	pinMode(_b2, OUTPUT); b2port->PIO_CODR = b2pin;
+	pinMode(_sclk, OUTPUT); sclkport->PIO_CODR = sclkpin;
+	pinMode(_latch, OUTPUT); latport->PIO_CODR = latpin;
+	pinMode(_oe, OUTPUT); oeport->PIO_CODR = oepin;  // LOW (enable output)
+	pinMode(_a, OUTPUT); addraport->PIO_CODR = addrapin;
+	pinMode(_b, OUTPUT); addrbport->PIO_CODR = addrbpin;
+	pinMode(_c, OUTPUT); addrcport->PIO_CODR = addrcpin;
 	if (nRows > 8) {
-		pinMode(_d, OUTPUT); digitalWrite(_d, LOW);
+		pinLookup(_d, &addrdport, &addrdpin);
+		pinMode(_d, OUTPUT); addrdport->PIO_CODR = addrdpin;
+	}
+
+	// Parallel bus wiring: if R1,G1,B1,R2,G2,B2 land on consecutive bits
+	// of a single PIO controller, in that order (e.g. Due pins 33-38 =
+	// PC1-PC6), the interrupt can set all six with one PIO_ODSR store per
+	// column.  SCLK may share the port as well (e.g. pin 39 = PC7), which
+	// saves a further store.  Any other wiring uses per-pin SODR/CODR.
+	// Further parallel chains add their six bits to the same store.
+	// A chain whose bits overlap an earlier chain's, or any control line
+	// on the same port, ends the bus just like an unset one.
+	databus   = busLookup(chainpins[0], &bit);
+	busChains = 0;
+	busbits   = 0;
+	if (databus) {
+		if (sclkport  == databus) busbits |= sclkpin;
+		if (latport   == databus) busbits |= latpin;
+		if (oeport    == databus) busbits |= oepin;
+		if (addraport == databus) busbits |= addrapin;
+		if (addrbport == databus) busbits |= addrbpin;
+		if (addrcport == databus) busbits |= addrcpin;
+		if ((nRows > 8) && (addrdport == databus)) busbits |= addrdpin;
+	}
+	while (databus && (busChains < nChains) && (chainset & (1 << busChains)) &&
+		(busLookup(chainpins[busChains], &bit) == databus) &&
+		!(busbits & (0x3FUL << bit))) {
+		busbits |= 0x3FUL << bit;
+		// Packed buffer bytes hold R1 in bit 2; line that up with the port.
+		// The interrupt masks off plane 0's bits 0,1 before shifting, so
+		// only the chain's own six bits reach the port.
+		if (bit >= 2) { busls[busChains] = bit - 2; busrs[busChains] = 0; }
+		else          { busls[busChains] = 0;       busrs[busChains] = 2 - bit; }
+		for (i = 0; i < 6; i++) {
+			pinMode(chainpins[busChains][i], OUTPUT);
+			databus->PIO_CODR = 1UL << (bit + i);
+		}
+		databus->PIO_OWER = 0x3FUL << bit;
+		busChains++;
 	}
+	if (databus && (sclkport == databus)) databus->PIO_OWER = sclkpin;
+
+	halAttachPanel(chainpins[0], nChains, _a, _b, _c, (nRows > 8) ? _d : 0,
+		_sclk, _latch, _oe, nCols, nRows);
+
+	calibrate();
 
-	debugPrint("startTimerCounter, now!");
 	startTimerCounter();
 
 }
+
+// Timer ticks (MCK/2) spent shifting out the most recent row, measured
+// in the interrupt handler.  Returned as CPU cycles for easier
+// comparison against other measurements.
+uint32_t GoodStuenPanel::rowCycles(void) {
+	return rowticks * 2;
+}
+
 // -------------------- Interrupt handler stuff --------------------
 
 void GoodStuenPanel::startTimerCounter(void) {
-	debugPrint("startTimerCounter: disable write protect");
 	pmc_set_writeprotect(false); // Disable "write protect" of the PMC (Power Management Controller) registers
 	pmc_enable_periph_clk(ID_TC0); // Power up the clock for interrupt controller peripheral
 
 	// Waveform mode | up mode with rc trigger | stop counter after trigger | use MCK/2 clock
-	TC_Configure(TC0, 0, TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC | TC_CMR_CPCSTOP | TC_CMR_TCCLKS_TIMER_CLOCK1);
+	// With hardware OE: TIOA0 low (LEDs on) as the timer is started, high
+	// (off) at the RA brightness cutoff and at the end of the interval.
+	TC_Configure(TC0, 0, TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC | TC_CMR_CPCSTOP | TC_CMR_TCCLKS_TIMER_CLOCK1 |
+		(hwoe ? (TC_CMR_ASWTRG_CLEAR | TC_CMR_ACPA_SET | TC_CMR_ACPC_SET) : 0));
+	if (hwoe) PIO_Configure(PIOB, PIO_PERIPH_B, PIO_PB25B_TIOA0, PIO_DEFAULT);
 	// Using Timer_Clock1, so counting to VARIANT_MCK / 2 gives 1 second
-	TC_SetRC(TC0, 0, 10000000); // Initial delay in ticks
+	TC_SetRC(TC0, 0, 1000); // Initial delay in ticks
 	TC_Start(TC0, 0);
 	TC0->TC_CHANNEL[0].TC_IER = TC_IER_CPCS;
 	TC0->TC_CHANNEL[0].TC_IDR = ~TC_IER_CPCS;
+	setBrightness(brightness); // Software cutoff needs the RA interrupt
+	TRACE1(TRACE_TIMER, 1000, 0); // While the interrupt can't trace too
 	NVIC_EnableIRQ(TC0_IRQn);
-
-	debugPrint("startTimerCounter: end");
 }
 
 // Handler for TC0 interrupt
 void TC0_Handler()
 {
-	debugPrint("TC0 Interrupt! START Righ!");
-	// don't change this area of code without also changing CALLOVERHEAD
-	activePanel->updateDisplay2();
+	isrEntry = DWT->CYCCNT; // Only used if stats are enabled, but cheap
+	// Read status to clear it and allow the interrupt to fire again.
+	// Time taken to get from here into updateDisplay() is measured by
+	// calibrate(), so changes here are picked up automatically
+	if (TC_GetStatus(TC0, 0) & TC_SR_CPCS) activePanel->updateDisplay();
+	else                                   activePanel->dimDisplay();
 
 	//TC_Start(TC0, 0); // Restart timer
-	//debugPrint(TC0->TC_CHANNEL[0].TC_CV);
-
-    TC_GetStatus(TC0, 0); // Read status to clear it and allow the interrupt to fire again
-    
-	debugPrint("TC0 Interrupt! END Righ!");
-}
-
-// Two constants are used in timing each successive BCM interval.
-// These were found empirically, by checking the value of TCNT1 at
-// certain positions in the interrupt code.
-// CALLOVERHEAD is the number of CPU 'ticks' from the timer overflow
-// condition (triggering the interrupt) to the first line in the
-// updateDisplay() method.  It's then assumed (maybe not entirely 100%
-// accurately, but close enough) that a similar amount of time will be
-// needed at the opposite end, restoring regular program flow.
-// LOOPTIME is the number of 'ticks' spent inside the shortest data-
-// issuing loop (not actually a 'loop' because it's unrolled, but eh).
-// Both numbers are rounded up slightly to allow a little wiggle room
-// should different compilers produce slightly different results.
-#define CALLOVERHEAD 35   // Actual value measured = 30
-#define LOOPTIME     6200 // Actual value measured = 6682 first loop 6171 2nd loop
-// The "on" time for bitplane 0 (with the shortest BCM interval) can
-// then be estimated as LOOPTIME + CALLOVERHEAD * 2.  Each successive
-// bitplane then doubles the prior amount of time.  We can then
-// estimate refresh rates from this:
-// 4 bitplanes = 320 + 640 + 1280 + 2560 = 4800 ticks per row.
-// 4800 ticks * 16 rows (for 32x32 matrix) = 76800 ticks/frame.
-// 16M CPU ticks/sec / 76800 ticks/frame = 208.33 Hz.
+}
+
+// Global brightness, 0-255, by cutting short how long the LEDs are on
+// in every BCM interval alike.  Nothing in the matrix buffer changes and
+// no color depth is lost; it just takes effect from the next interval.
+// With OE on pin 2 the timer switches OE itself; otherwise an RA
+// compare interrupt does it (only while below full brightness), which
+// can't cut in before the interrupt shifting out the next row returns,
+// so very low levels bottom out there.  0 holds OE off altogether: the
+// interrupt stops switching it on, and on pin 2 the pin is taken back
+// from the timer while it lasts.
+void GoodStuenPanel::setBrightness(uint8_t level) {
+	brightness = level;
+	if (hwoe || (level == 0) || (level == 255))
+		TC0->TC_CHANNEL[0].TC_IDR = TC_IDR_CPAS;
+	else
+		TC0->TC_CHANNEL[0].TC_IER = TC_IER_CPAS;
+	if (hwoe && (activePanel == this)) {
+		if (level) {
+			oeport->PIO_PDR  = oepin; // TIOA0 again
+		} else {
+			oeport->PIO_SODR = oepin; // PIO, high
+			oeport->PIO_PER  = oepin;
+		}
+	}
+}
+
+// RA compare interrupt for software brightness: end of the "on" time.
+// Profiled apart from the refresh interrupts (see getStats()).
+void GoodStuenPanel::dimDisplay(void) {
+	uint32_t cycles;
+
+	oeport->PIO_SODR = oepin;
+	if (statson) {
+		cycles = DWT->CYCCNT - isrEntry;
+		if (cycles < dimacc.min) dimacc.min = cycles;
+		if (cycles > dimacc.max) dimacc.max = cycles;
+		dimacc.sum += cycles;
+		dimacc.count++;
+	}
+}
+
+// Two values are used in timing each successive BCM interval.  They
+// were once constants found empirically, by checking the value of TCNT1
+// at certain positions in the interrupt code; now calibrate() measures
+// them with the timer itself when begin() runs, so they follow compiler
+// flags, pin choices and scan-out mode.
+// callOverhead is the number of timer ticks from the compare match
+// (triggering the interrupt) to the first line in the updateDisplay()
+// method.  It's then assumed (maybe not entirely 100% accurately, but
+// close enough) that a similar amount of time will be needed at the
+// opposite end, restoring regular program flow.
+// loopTime is the number of ticks spent shifting out one row of one
+// plane -- the slower of plane 0 (gathered from three bytes) and the
+// rest.  Both are rounded up a little to allow some wiggle room.
+// (For reference, the hand-tuned values were 35 and 600 per panel for
+// the per-pin SODR/CODR loop; the original 6200 ticks dated from eight
+// digitalWrite() calls per column.  rowCycles() reports the measured
+// shift time of the most recent row at run time.)
+// The "on" time for bitplane 0 (with the shortest BCM interval) is
+// then loopTime + callOverhead * 2.  Each successive bitplane then
+// doubles the prior amount of time, so a row takes
+// (loopTime + callOverhead * 2) * (2^planes - 1) ticks, and a frame
+// 16 times that on a 32x32 matrix.  Timer ticks are MCK/2 = 42 MHz.
+// CPU use is roughly one loopTime + callOverhead * 2 per plane out of
+// the row time, i.e. planes / (2^planes - 1).  Chained panels stretch
+// loopTime (and so every interval) by the number of panels.  With the
+// old per-pin figures, a single 32x32 matrix works out to:
+//
+//   planes  colors  buffer  ticks/row  refresh  CPU use
+//     4       4K     1.5K     10050    261 Hz    27%
+//     5      32K     2K       20770    126 Hz    16%
+//     6     262K     2.5K     42210     62 Hz    10%
+//     7       2M     3K       85090     31 Hz     6%
+//     8      16M     3.5K    170850     15 Hz     3%
+//
 // Actual frame rate will be slightly less due to work being done
-// during the brief "LEDs off" interval...it's reasonable to say
-// "about 200 Hz."  The 16x32 matrix only has to scan half as many
-// rows...so we could either double the refresh rate (keeping the CPU
-// load the same), or keep the same refresh rate but halve the CPU
+// during the brief "LEDs off" interval.  Beyond 5 planes the refresh
+// rate drops into visible flicker unless loopTime comes down (parallel
+// bus or DMA scan-out); refreshRate() gives the estimate for the
+// current configuration.  The 16x32 matrix only has to scan half as
+// many rows...so we could either double the refresh rate (keeping the
+// CPU load the same), or keep the same refresh rate but halve the CPU
 // load.  We opted for the latter.
-// Can also estimate CPU use: bitplanes 1-3 all use 320 ticks to
-// issue data (the increasing gaps in the timing invervals are then
-// available to other code), and bitplane 0 takes 920 ticks out of
-// the 2560 tick interval.
-// 320 * 3 + 920 = 1880 ticks spent in interrupt code, per row.
-// From prior calculations, about 4800 ticks happen per row.
-// CPU use = 1880 / 4800 = ~39% (actual use will be very slightly
-// higher, again due to code used in the LEDs off interval).
-// 16x32 matrix uses about half that CPU load.  CPU time could be
-// further adjusted by padding the LOOPTIME value, but refresh rates
-// will decrease proportionally, and 200 Hz is a decent target.
+
+// Measure callOverhead and loopTime for the current scan-out mode.  The
+// timer free-runs meanwhile, its RC compare still raising the interrupt,
+// so how far past the match the handler gets to updateDisplay() is the
+// entry overhead.  If the interrupt doesn't come within a millisecond
+// (interrupts masked, or held off by a higher priority), the default
+// overhead is used instead.  Leaves the interrupt disabled;
+// startTimerCounter() sets the timer back up for refresh.
+void GoodStuenPanel::calibrate(void) {
+	uint32_t t, worst = 0;
+	uint8_t  p;
+
+	NVIC_DisableIRQ(TC0_IRQn);
+	pmc_set_writeprotect(false);
+	pmc_enable_periph_clk(ID_TC0);
+	TC_Configure(TC0, 0, TC_CMR_WAVE | TC_CMR_WAVSEL_UP | TC_CMR_TCCLKS_TIMER_CLOCK1);
+	TC_Start(TC0, 0);
+
+	// Dry run of the shift loop (OE is still off, or the row about to be
+	// replaced anyway, so nothing shows) for plane 0 and plane 1.
+	for (p = 0; p < 2; p++) {
+		t = TC0->TC_CHANNEL[0].TC_CV;
+		if (dmabuff) {
+			while (DMAC->DMAC_CHSR & (DMAC_CHSR_ENA0 << DMACH)); // Last row
+			t = TC0->TC_CHANNEL[0].TC_CV;
+			dmaRow(0, p);
+			while (DMAC->DMAC_CHSR & (DMAC_CHSR_ENA0 << DMACH));
+		} else {
+			shiftRow(matrixbuff[frontindex], p);
+		}
+		t = TC0->TC_CHANNEL[0].TC_CV - t;
+		if (t > worst) worst = t;
+	}
+	loopTime = worst + (worst >> 3) + 8;
+
+	// Interrupt entry: a compare match a short way ahead, then see how
+	// far past it updateDisplay() starts.
+	calibrating = true;
+	TC0->TC_CHANNEL[0].TC_IER = TC_IER_CPCS;
+	TC0->TC_CHANNEL[0].TC_IDR = ~TC_IER_CPCS;
+	TC_GetStatus(TC0, 0);
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; // Cycle counter for
+	DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;    // the deadline
+	TC_SetRC(TC0, 0, TC0->TC_CHANNEL[0].TC_CV + 200);
+	NVIC_ClearPendingIRQ(TC0_IRQn);
+	t = DWT->CYCCNT;
+	NVIC_EnableIRQ(TC0_IRQn);
+	while (calibrating && ((DWT->CYCCNT - t) < (VARIANT_MCK / 1000))); // 1 ms
+	NVIC_DisableIRQ(TC0_IRQn);
+	if (calibrating) {
+		calibrating  = false;
+		callOverhead = CALLOVERHEAD; // loopTime above still holds
+	} else {
+		callOverhead = entryticks + (entryticks >> 3) + 2;
+	}
+	TRACE1(TRACE_CALIBRATE, callOverhead, loopTime);
+}
+
+// Drive one data line from a bit test.  SODR/CODR only touch the bits
+// that are set in the mask, so no read-modify-write of the port is needed
+// and other pins on the same PIO controller are left alone.
+#define DATAOUT(port, pin, bit) \
+	if (bit) port->PIO_SODR = pin; \
+	else     port->PIO_CODR = pin
+
+// Parallel bus words for one column: plane 0 gathered from the least 2
+// bits of its three bytes (same arrangement as the AVR DATAPORT write),
+// other planes used as-is, then shifted into the data pins' position.
+#define BUSPLANE0(i) \
+	(((uint32_t)(((ptr[i]    << 6) & 0xC0) | \
+	             ((ptr[i+nCols]   << 4) & 0x30) | \
+	             ((ptr[i+nCols*2] << 2) & 0x0C)) << busls[0]) >> busrs[0])
+#define BUSPLANEN(i) \
+	(((uint32_t)(ptr[i] & 0xFC) << busls[0]) >> busrs[0])
+
+// Parallel chains: OR together every chain's contribution to the bus word
+// for the column at 'ptr' (in chain 0); each further chain's bytes are
+// chainStride further along in the buffer.
+inline uint32_t GoodStuenPanel::busWord(const uint8_t *ptr, boolean plane0) {
+	uint32_t w = 0, d;
+	uint8_t  k;
+
+	for (k = 0; k < busChains; k++, ptr += chainStride) {
+		d = plane0 ?
+			(((ptr[0] << 6) & 0xC0) | ((ptr[nCols] << 4) & 0x30) |
+			 ((ptr[nCols * 2] << 2) & 0x0C)) : (ptr[0] & 0xFC);
+		w |= (d << busls[k]) >> busrs[k];
+	}
+	return w;
+}
+
+// Clock one row's worth of data for a single bitplane out to the matrix.
+// Plane 0 has to be unpacked from the 2 least bits of the three bytes
+// per column; the other planes are stored in the top 6 bits, already in
+// R1,G1,B1,R2,G2,B2 order.
+void GoodStuenPanel::shiftRow(uint8_t *ptr, uint8_t plane) {
+	uint16_t i;
+
+	if (databus) {
+		// Parallel bus: all six data lines sit in consecutive bits of one
+		// PIO controller (see begin()), so each column is a single masked
+		// PIO_ODSR store -- the Due counterpart to the AVR 'pew' macro.
+		// Only bits enabled in PIO_OWSR are affected by the store.  If
+		// SCLK is on the same port, it's in that mask too and the store
+		// drops the clock along with the data; otherwise it's separate.
+		// Bits outside the six data lines are masked off first so they
+		// can't land on the clock bit.
+		if (busChains > 1) {
+			// Several chains: each column's word gathers one byte per chain
+			for (i = 0; i < nCols; i++) {
+				databus->PIO_ODSR = busWord(&ptr[i], plane == 0);
+				sclkport->PIO_CODR = sclkpin; // (no-op if SCLK on the bus)
+				sclkport->PIO_SODR = sclkpin;
+			}
+		} else if (sclkport == databus) {
+			if (plane == 0) {
+				for (i = 0; i < nCols; i++) {
+					databus->PIO_ODSR = BUSPLANE0(i); // Clock lo + data
+					sclkport->PIO_SODR = sclkpin;     // Clock hi
+				}
+			} else {
+				for (i = 0; i < nCols; i++) {
+					databus->PIO_ODSR = BUSPLANEN(i);
+					sclkport->PIO_SODR = sclkpin;
+				}
+			}
+		} else {
+			if (plane == 0) {
+				for (i = 0; i < nCols; i++) {
+					databus->PIO_ODSR = BUSPLANE0(i);
+					sclkport->PIO_CODR = sclkpin;
+					sclkport->PIO_SODR = sclkpin;
+				}
+			} else {
+				for (i = 0; i < nCols; i++) {
+					databus->PIO_ODSR = BUSPLANEN(i);
+					sclkport->PIO_CODR = sclkpin;
+					sclkport->PIO_SODR = sclkpin;
+				}
+			}
+		}
+		return;
+	}
+
+	if (plane == 0) {
+		for (i = 0; i < nCols; i++) {
+			DATAOUT(b2port, b2pin, ptr[i] & 0x02);       // 0000 0010
+			DATAOUT(g2port, g2pin, ptr[i] & 0x01);       // 0000 0001
+			DATAOUT(r2port, r2pin, ptr[i + nCols] & 0x02);      // 0000 0010
+			DATAOUT(b1port, b1pin, ptr[i + nCols] & 0x01);      // 0000 0001
+			DATAOUT(g1port, g1pin, ptr[i + nCols * 2] & 0x02);  // 0000 0010
+			DATAOUT(r1port, r1pin, ptr[i + nCols * 2] & 0x01);  // 0000 0001
+			sclkport->PIO_CODR = sclkpin;
+			sclkport->PIO_SODR = sclkpin;
+		}
+	} else {
+		for (i = 0; i < nCols; i++) {
+			DATAOUT(b2port, b2pin, ptr[i] & 0x80); // 1000 0000
+			DATAOUT(g2port, g2pin, ptr[i] & 0x40); // 0100 0000
+			DATAOUT(r2port, r2pin, ptr[i] & 0x20); // 0010 0000
+			DATAOUT(b1port, b1pin, ptr[i] & 0x10); // 0001 0000
+			DATAOUT(g1port, g1pin, ptr[i] & 0x08); // 0000 1000
+			DATAOUT(r1port, r1pin, ptr[i] & 0x04); // 0000 0100
+			sclkport->PIO_CODR = sclkpin;
+			sclkport->PIO_SODR = sclkpin;
+		}
+	}
+}
 
 // The flow of the interrupt can be awkward to grasp, because data is
 // being issued to the LED matrix for the *next* bitplane and/or row
@@ -488,24 +1902,44 @@ void TC0_Handler()
 // function...hopefully tenses are sufficiently commented.
 
 void GoodStuenPanel::updateDisplay(void) {
-	uint8_t  i, tick, tock, *ptr;
-	uint16_t t, duration;
+	uint8_t  *ptr;
+	uint32_t t, duration, ontime;
+
+	if (calibrating) {
+		// See calibrate(): just note how long it took to get here
+		entryticks  = TC0->TC_CHANNEL[0].TC_CV - TC0->TC_CHANNEL[0].TC_RC;
+		calibrating = false;
+		return;
+	}
 
-	digitalWrite(_oe, HIGH);    // Disable LED output during row/plane switchover
+	oeport->PIO_SODR = oepin;   // Disable LED output during row/plane switchover
+	TRACE2(TRACE_ISR, row, plane);
+	if (dmabuff) {
+		// Row data is being streamed by the DMA controller; it normally
+		// finished long ago, but mustn't be latched halfway through.
+		while (DMAC->DMAC_CHSR & (DMAC_CHSR_ENA0 << DMACH));
+	}
+	latport->PIO_SODR = latpin; // Latch data loaded during *prior* interrupt
 
-	digitalWrite(_latch, HIGH); // Latch data loaded during *prior* interrupt
-	
 	// Calculate time to next interrupt BEFORE incrementing plane #.
 	// This is because duration is the display time for the data loaded
-	// on the PRIOR interrupt.  CALLOVERHEAD is subtracted from the
+	// on the PRIOR interrupt.  callOverhead is subtracted from the
 	// result because that time is implicit between the timer overflow
 	// (interrupt triggered) and the initial LEDs-off line at the start
 	// of this method.
-	t = (nRows > 8) ? LOOPTIME : (LOOPTIME * 2);
-	duration = ((t + CALLOVERHEAD * 2) << plane) - CALLOVERHEAD;
-	
-    
-    
+	t = (nRows > 8) ? loopTime : (loopTime * 2);
+	if (onunit) {
+		// Exact timing: the LEDs are on for precisely onunit << plane
+		// ticks, switched by the timer; the interval only has to be long
+		// enough for the next row's data to be shifted out.
+		ontime   = onunit << plane;
+		duration = t + callOverhead;
+		if (ontime > duration) duration = ontime;
+	} else {
+		duration = ((t + callOverhead * 2) << plane) - callOverhead;
+		ontime   = duration;
+	}
+
 	// Borrowing a technique here from Ray's Logic:
 	// www.rayslogic.com/propeller/Programming/AdafruitRGB/AdafruitRGB.htm
 	// This code cycles through all four planes for each scanline before
@@ -513,137 +1947,409 @@ void GoodStuenPanel::updateDisplay(void) {
 	// advance lines every time and interleave the planes to reduce
 	// vertical scanning artifacts, in practice with this panel it causes
 	// a green 'ghosting' effect on black pixels, a much worse artifact.
-	
+
 	if (++plane >= nPlanes) {      // Advance plane counter.  Maxed out?
 		plane = 0;                  // Yes, reset to plane 0, and
 		if (++row >= nRows) {        // advance row counter.  Maxed out?
 			row = 0;              // Yes, reset row counter, then...
-			if (swapflag == true) {    // Swap front/back buffers if requested
-				backindex = 1 - backindex;
+			if (nFrames > 2) {         // Frame queue: show next in line
+				if (qcount) {
+					if (qpolicy == FRAME_LATEST) {
+						while (qcount > 1) { // Skip straight to newest
+							qhead = (qhead + 1) & (MAXFRAMES - 1);
+							qcount--;
+							dropped++;
+						}
+					}
+					frontindex = fqueue[qhead];
+					qhead = (qhead + 1) & (MAXFRAMES - 1);
+					qcount--;
+					TRACE2(TRACE_SWAP, frontindex, qcount);
+					if (swapcallback) swapcallback();
+				} else {
+					repeated++;
+				}
+			} else if (swapflag == true) { // Swap front/back buffers if requested
+				backindex  = 1 - backindex;
+				frontindex = 1 - backindex;
+				if (dmaback) { // Last row's transfer finished above
+					uint32_t *d = dmabuff;
+					dmabuff = dmaback;
+					dmaback = d;
+				}
 				swapflag = false;
+				TRACE2(TRACE_SWAP, frontindex, 0);
+				if (swapcallback) swapcallback();
 			}
-			//buffptr = matrixbuff[1 - backindex]; // Reset into front buffer TODO put back in
+			// Reset into front buffer, at the next dither phase's image
+			if (++frcphase >= nPhases) frcphase = 0;
+			buffptr = matrixbuff[frontindex] + frcphase * phaseSize;
 		}
 	}
 	else if (plane == 1) {
 		// Plane 0 was loaded on prior interrupt invocation and is about to
 		// latch now, so update the row address lines before we do that:
-		if (row & 0x1)   digitalWrite(_a, HIGH);
-		else            digitalWrite(_a, LOW);
-		if (row & 0x2)   digitalWrite(_b, HIGH);
-		else            digitalWrite(_b, LOW);
-		if (row & 0x4)   digitalWrite(_c, HIGH);
-		else            digitalWrite(_c, LOW);
+		if (row & 0x1)   addraport->PIO_SODR = addrapin;
+		else            addraport->PIO_CODR = addrapin;
+		if (row & 0x2)   addrbport->PIO_SODR = addrbpin;
+		else            addrbport->PIO_CODR = addrbpin;
+		if (row & 0x4)   addrcport->PIO_SODR = addrcpin;
+		else            addrcport->PIO_CODR = addrcpin;
 		if (nRows > 8) {
-			if (row & 0x8) digitalWrite(_d, HIGH);
-			else          digitalWrite(_d, LOW);
+			if (row & 0x8) addrdport->PIO_SODR = addrdpin;
+			else          addrdport->PIO_CODR = addrdpin;
 		}
 	}
-	
-	// TODO: optimize planes 1-3, look at compiler output
 
+	// buffptr, being 'volatile' type, doesn't take well to optimization.
+	// A local register copy can speed some things up:
 	ptr = (uint8_t *)buffptr;
-	
+
+	// Brightness: LEDs go off again this far into the interval, but at
+	// least a tick in.  At full brightness that's the end anyway (or the
+	// exact on time).  At 0 they're never switched on (see
+	// setBrightness()).
+	t = (brightness == 255) ? ontime : ((ontime * brightness) >> 8);
+	TC0->TC_CHANNEL[0].TC_RA = t ? t : 1;
 	TC_SetRC(TC0, 0, duration); // Set interval for next interrupt (in timer ticks, not clocks!)
 	TC_Start(TC0, 0);           // Setting CPCSTOP bit in CMR register means we need to restart the timer ourselves
-	
-	digitalWrite(_oe, LOW);    // Re-enable output
-	digitalWrite(_latch, LOW); // Latch down
-	
-    if (plane == 0) {
-        for(i=0; i<32; i++) {
-          digitalWrite(_b2, ptr[i] & 0x02);       // 0000 0010
-          digitalWrite(_g2, ptr[i] & 0x01);       // 0000 0001
-          digitalWrite(_r2, ptr[i + 32] & 0x02);  // 0000 0010
-          digitalWrite(_b1, ptr[i + 32] & 0x01);  // 0000 0001
-          digitalWrite(_g1, ptr[i + 64] & 0x02);  // 0000 0010
-          digitalWrite(_r1, ptr[i + 64] & 0x01);  // 0000 0001
-          digitalWrite(_sclk, LOW);
-          digitalWrite(_sclk, HIGH);
-        }
-    }
-    else {
-        for(i=0; i<32; i++) {
-          digitalWrite(_b2, ptr[i] & 0x80); // 1000 0000
-          digitalWrite(_g2, ptr[i] & 0x40); // 0100 0000
-          digitalWrite(_r2, ptr[i] & 0x20); // 0010 0000
-          digitalWrite(_b1, ptr[i] & 0x10); // 0001 0000
-          digitalWrite(_g1, ptr[i] & 0x08); // 0000 1000
-          digitalWrite(_r1, ptr[i] & 0x04); // 0000 0100
-          digitalWrite(_sclk, LOW);
-          digitalWrite(_sclk, HIGH);
-        } 
-    }
-	
-}
-
-void GoodStuenPanel::updateDisplay2(void) {
-	uint8_t  i, tick, tock, *ptr;
-	uint16_t t, duration;
-
-	uint16_t debugCounter = 0;
-	
-	digitalWrite(_oe, HIGH);    // Disable LED output during row/plane switchover
-	
-	digitalWrite(_latch, HIGH); // Latch data loaded during *prior* interrupt
-	
-	// Calculate time to next interrupt BEFORE incrementing plane #.
-	// This is because duration is the display time for the data loaded
-	// on the PRIOR interrupt.  CALLOVERHEAD is subtracted from the
-	// result because that time is implicit between the timer overflow
-	// (interrupt triggered) and the initial LEDs-off line at the start
-	// of this method.
-	//t = (nRows > 8) ? LOOPTIME : (LOOPTIME * 2);
-	//duration = ((t + CALLOVERHEAD * 2) << plane) - CALLOVERHEAD;
-	
-	// Borrowing a technique here from Ray's Logic:
-	// www.rayslogic.com/propeller/Programming/AdafruitRGB/AdafruitRGB.htm
-	// This code cycles through all four planes for each scanline before
-	// advancing to the next line.  While it might seem beneficial to
-	// advance lines every time and interleave the planes to reduce
-	// vertical scanning artifacts, in practice with this panel it causes
-	// a green 'ghosting' effect on black pixels, a much worse artifact.
-	
-	
-    if (++row >= nRows) {        // advance row counter.  Maxed out?
-        row = 0;              // Yes, reset row counter, then...
-        buffptr = matrixbuff2;
-    }
-
-    // Plane 0 was loaded on prior interrupt invocation and is about to
-    // latch now, so update the row address lines before we do that:
-    if (row & 0x1)   digitalWrite(_a, HIGH);
-    else            digitalWrite(_a, LOW);
-    if (row & 0x2)   digitalWrite(_b, HIGH);
-    else            digitalWrite(_b, LOW);
-    if (row & 0x4)   digitalWrite(_c, HIGH);
-    else            digitalWrite(_c, LOW);
-    if (nRows > 8) {
-        if (row & 0x8) digitalWrite(_d, HIGH);
-        else          digitalWrite(_d, LOW);
-    }
-	
-	
-	// TODO: optimize planes 1-3, look at compiler output
 
-	ptr = (uint8_t *)buffptr;
-	
-	//TC_SetRC(TC0, 0, duration); // Set interval for next interrupt (in timer ticks, not clocks!)
-	TC_Start(TC0, 0);           // Setting CPCSTOP bit in CMR register means we need to restart the timer ourselves
+	if (brightness) oeport->PIO_CODR = oepin; // Re-enable output
+	latport->PIO_CODR = latpin; // Latch down
+
+	if (dmabuff) dmaRow(row, plane); // DMA controller shifts the row out
+	else         shiftRow(ptr, plane);
+
+	// Planes 1 and up each occupy their own run of nCols bytes in the row;
+	// plane 0 is spread across the first three, so doesn't advance.
+	if (plane > 0) buffptr = ptr + nCols;
+
+	rowticks = TC0->TC_CHANNEL[0].TC_CV; // Timer was restarted above
+	TRACE2(TRACE_ISR_END, rowticks, duration);
+
+	if (statson) recordStats(DWT->CYCCNT - isrEntry);
+}
+
+// Estimated refresh rate in Hz for the configured plane count, from
+// the calibrated BCM timing above.
+uint16_t GoodStuenPanel::refreshRate(void) {
+	uint32_t t = (nRows > 8) ? loopTime : (loopTime * 2), row = 0, on;
+	uint8_t  p;
+
+	if (onunit) {
+		// Short planes take as long as the shift, longer ones their on time
+		for (p = 0; p < nPlanes; p++) {
+			on   = onunit << p;
+			row += ((on > (t + callOverhead)) ? on : (t + callOverhead)) +
+				callOverhead;
+		}
+	} else {
+		row = (t + callOverhead * 2) * ((1UL << nPlanes) - 1);
+	}
+	return (VARIANT_MCK / 2) / (row * nRows);
+}
+
+// Exact BCM timing, for OE on pin 2 (TIOA0; see setBrightness()): the
+// timer's RA compare switches the LEDs off after exactly 'unit' << plane
+// ticks (MCK/2) in each interval, rather than the on time being however
+// long the interval is.  Intervals are then only as long as the on time
+// or the next row's shift, whichever is longer, so the shortest planes
+// can be far shorter than the interrupt -- more planes or a faster
+// refresh for the same CPU time.  The lowest planes also end up with
+// some dark time, so overall brightness is a little lower.  'unit' 0
+// goes back to the usual timing.  Returns false (and leaves timing as
+// is) if OE isn't on TIOA0.  Before begin() the pins haven't been looked
+// up yet, so the setting is just kept, and begin() drops it again if OE
+// turns out not to be on TIOA0 (calling again after begin() tells which).
+boolean GoodStuenPanel::setExactTiming(uint16_t unit) {
+	if (unit && !hwoe && (activePanel == this)) return false;
+	onunit = unit;
+	return true;
+}
+
+// Rough share of CPU time taken by the refresh interrupt, in percent:
+// time spent in the most recent row (plus entry/exit overhead) against
+// the interval until the next interrupt.  While the brightness cutoff
+// needs the RA compare interrupt, there's one of those per interval
+// too; it does next to nothing, so just its entry/exit is added.
+uint8_t GoodStuenPanel::cpuLoad(void) {
+	uint32_t rc = TC0->TC_CHANNEL[0].TC_RC,
+	         t  = rowticks + callOverhead * 2;
+	if (!hwoe && (brightness > 0) && (brightness < 255)) t += callOverhead * 2;
+	return rc ? (uint8_t)((t * 100) / rc) : 0;
+}
+
+// Print up to 'max' logged trace events, oldest first, one per line:
+// cycle count, event name, two arguments.  Call from loop(), never from
+// an interrupt.  Returns the number printed (always 0 with TRACE_LEVEL
+// 0).
+uint8_t GoodStuenPanel::drainTrace(Print &out, uint8_t max) {
+#if TRACE_LEVEL > 0
+	static const char * const names[] = {
+		"begin", "calibrate", "timer", "isr", "isr-end", "swap", "dma" };
+	TraceEvent e;
+	uint8_t    t, n = 0;
+
+	if (traceLost) {
+		out.print("trace: lost ");
+		out.println(traceLost);
+		traceLost = 0;
+	}
+	t = traceTail; // Only this side writes it
+	while ((n < max) && (t != __atomic_load_n(&traceHead, __ATOMIC_ACQUIRE))) {
+		e = traceBuf[t]; // Copy out before handing the slot back
+		t = (t + 1) & (TRACESIZE - 1);
+		__atomic_store_n(&traceTail, t, __ATOMIC_RELEASE);
+		out.print(e.time);
+		out.print(' ');
+		out.print(names[e.id]);
+		out.print(' ');
+		out.print(e.a);
+		out.print(' ');
+		out.println(e.b);
+		n++;
+	}
+	return n;
+#else
+	(void)out;
+	(void)max;
+	return 0;
+#endif
+}
+
+// -------------------- Profiling --------------------
+
+// Opt-in profile of the refresh interrupt, cheap enough to leave on: a
+// cycle counter read at either end and a few adds and compares per
+// interrupt.  Turning it on starts a fresh sample.
+void GoodStuenPanel::enableStats(boolean on) {
+	if (on) {
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; // Enable DWT
+		DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;    // and its counter
+		statson = false;
+		resetStats();
+	}
+	statson = on;
+}
+
+// Called from the interrupt with the cycles it took to load the current
+// plane of the current row.
+inline void GoodStuenPanel::recordStats(uint32_t cycles) {
+	StatsAcc *a;
+	uint8_t   bin;
+
+	a = &planeacc[plane];
+	if (cycles < a->min) a->min = cycles;
+	if (cycles > a->max) a->max = cycles;
+	a->sum += cycles;
+	a->count++;
+
+	a = &rowacc[row];
+	if (cycles < a->min) a->min = cycles;
+	if (cycles > a->max) a->max = cycles;
+	a->sum += cycles;
+	a->count++;
+
+	bin = 31 - __builtin_clz(cycles | 1); // log2, one CLZ instruction
+	bin = (bin < 8) ? 0 : (bin - 7);
+	if (bin >= STATSBINS) bin = STATSBINS - 1;
+	if (hist[plane][bin] < 0xFFFF) hist[plane][bin]++;
+	if (rowhist[row][bin] < 0xFFFF) rowhist[row][bin]++;
+
+	if ((row == 0) && (plane == 0)) statsframes++;
+}
+
+void GoodStuenPanel::resetStats(void) {
+	uint8_t i;
+
+	for (i = 0; i < MAXPLANES; i++) {
+		planeacc[i].min = 0xFFFFFFFF;
+		planeacc[i].max = planeacc[i].count = 0;
+		planeacc[i].sum = 0;
+	}
+	for (i = 0; i < MAXROWS; i++) {
+		rowacc[i].min   = 0xFFFFFFFF;
+		rowacc[i].max   = rowacc[i].count = 0;
+		rowacc[i].sum   = 0;
+	}
+	dimacc.min = 0xFFFFFFFF;
+	dimacc.max = dimacc.count = 0;
+	dimacc.sum = 0;
+	memset(hist, 0, sizeof(hist));
+	memset(rowhist, 0, sizeof(rowhist));
+	statsframes = 0;
+	statsstart  = millis();
+}
+
+// Boil one accumulator down to min/max/mean.
+static void spanOf(GoodStuenSpan *s, uint32_t min, uint32_t max,
+	uint32_t count, uint64_t sum) {
+	s->min  = count ? min : 0;
+	s->max  = max;
+	s->mean = count ? (uint32_t)(sum / count) : 0;
+}
+
+// Snapshot of the refresh interrupt profile since stats were enabled
+// (or last reset).  The interrupt is only held off while the raw
+// counters are copied, so reading stats barely disturbs the BCM
+// interval in progress; the arithmetic happens afterwards.  CPU load
+// counts the brightness cutoff interrupts as well, and allows for the
+// calibrated interrupt entry and exit time outside the measured spans.
+void GoodStuenPanel::getStats(GoodStuenStats *stats, boolean reset) {
+	StatsAcc pa[MAXPLANES], ra[MAXROWS], da;
+	uint32_t min = 0xFFFFFFFF, max = 0, count = 0, frames;
+	uint64_t sum = 0;
+	uint8_t  i;
+
+	NVIC_DisableIRQ(TC0_IRQn); // Consistent snapshot
+	memcpy(pa, planeacc, sizeof(pa));
+	memcpy(ra, rowacc, sizeof(ra));
+	da             = dimacc;
+	memcpy(stats->hist, hist, sizeof(hist));
+	memcpy(stats->rowhist, rowhist, sizeof(rowhist));
+	frames         = statsframes;
+	stats->elapsed = millis() - statsstart;
+	if (reset) resetStats();
+	NVIC_EnableIRQ(TC0_IRQn);
+
+	for (i = 0; i < MAXPLANES; i++) {
+		spanOf(&stats->plane[i], pa[i].min, pa[i].max, pa[i].count, pa[i].sum);
+		if (pa[i].min < min) min = pa[i].min;
+		if (pa[i].max > max) max = pa[i].max;
+		count += pa[i].count;
+		sum   += pa[i].sum;
+	}
+	for (i = 0; i < MAXROWS; i++) {
+		spanOf(&stats->row[i], ra[i].min, ra[i].max, ra[i].count, ra[i].sum);
+	}
+	stats->fps = stats->elapsed ?
+		(uint16_t)((frames * 1000UL) / stats->elapsed) : 0;
+
+	spanOf(&stats->all, min, max, count, sum);
+	spanOf(&stats->dim, da.min, da.max, da.count, da.sum);
+	stats->interrupts    = count;
+	stats->dimInterrupts = da.count;
+	count += da.count;
+	sum   += da.sum + (uint64_t)count * callOverhead * 4; // Ticks are 2 cycles; both ends
+	stats->cpuLoad = stats->elapsed ? (uint8_t)((sum * 100) /
+		((uint64_t)stats->elapsed * (VARIANT_MCK / 1000))) : 0;
+}
+
+// -------------------- DMA scan-out --------------------
+
+// With the parallel data bus and SCLK on that same PIO controller, each
+// column is just two port states (data + clock lo, data + clock hi).  A
+// whole frame of those can be encoded ahead of time and handed to the
+// SAM3X DMA controller one row at a time, leaving the interrupt only the
+// latch, row address and OE work at row/plane boundaries.  The DMAC has
+// no hardware handshake with the timers or PIO, so transfers run as
+// memory-to-memory copies into PIO_ODSR, paced by the bus itself; that
+// works out to a few MHz of SCLK, well within what the panels accept.
+// Costs 8 bytes per column per row per plane (16K for a 32x32 panel),
+// twice over when double-buffered: the DMAC may be reading the frame on
+// display at any moment, so the next one is encoded into a second buffer
+// as it's presented, and the interrupt switches over at the end of a
+// refresh along with the packed buffers.
+
+// Allocate the DMA word buffer(s) and switch the interrupt over to DMA
+// scan-out.  Call after begin().  Returns false (and carries on with
+// CPU scan-out) if the pins aren't wired as a single bus with SCLK,
+// there's not enough RAM, dithering or a frame queue is on, or there is
+// no DMA controller (the host emulator).
+boolean GoodStuenPanel::enableDMA(void) {
+	uint32_t *buf, words = nRows * nPlanes * nCols * 2;
+
+	if (dmabuff) return true;
+	if (!databus || (sclkport != databus)) return false;
+	if (nPhases > 1) return false; // Would need re-encoding every refresh
+	if (nFrames > 2) return false; // Would need a DMA buffer per frame
+	if (!HAL_HAS_DMA) return false;
+	if (NULL == (buf = (uint32_t *)malloc(
+		words * ((nFrames == 2) ? 2 : 1) * sizeof(uint32_t)))) return false;
+
+	// Stop refresh, LEDs off, while the scan-out mode changes; from here
+	// on it's set up just as in begin().  A swap may already be pending,
+	// so the spare words get the back buffer (presentFrame() refills
+	// them for every later frame).
+	NVIC_DisableIRQ(TC0_IRQn);
+	TC_Stop(TC0, 0);
+	oeport->PIO_SODR = oepin;
+	oeport->PIO_PER  = oepin; // If TIOA0, the timer gets it back below
+	encodeFrame(buf, matrixbuff[frontindex], ALLROWS);
+	if (nFrames == 2) {
+		dmaback = &buf[words];
+		encodeFrame(dmaback, matrixbuff[backindex], ALLROWS);
+	}
+
+	pmc_enable_periph_clk(ID_DMAC);
+	DMAC->DMAC_EN = 0;
+	DMAC->DMAC_GCFG = DMAC_GCFG_ARB_CFG_ROUND_ROBIN;
+	DMAC->DMAC_EN = DMAC_EN_ENABLE;
+	DMAC->DMAC_CHDR = DMAC_CHDR_DIS0 << DMACH;
+
+	dmabuff = buf;
+	TRACE1(TRACE_DMA, words * sizeof(uint32_t), 0);
+
+	// Row transfers take less time than the CPU loop; measure them.
+	calibrate();
+	startTimerCounter();
+	return true;
+}
+
+// Re-encode the displayed buffer into DMA words after drawing into it,
+// while DMA scan-out is active and single-buffered; the interrupt never
+// looks at the packed buffer in that mode.  Only rows drawn into since
+// the last call are re-encoded (and the dirty rows cleared).  Rows on
+// display may briefly show a mix of old and new, just as drawing into
+// them does with CPU scan-out.  Double-buffered, presenting a frame
+// encodes it, so there's nothing to do here.
+void GoodStuenPanel::updateDMA(void) {
+	if (!dmabuff || (nFrames > 1)) return;
+	encodeFrame(dmabuff, matrixbuff[frontindex], dirty);
+	clearDirty();
+}
+
+// Convert the given scan rows of a packed matrix buffer into per-row,
+// per-plane column words laid out in the order dmaRow() streams them.
+void GoodStuenPanel::encodeFrame(uint32_t *dst, uint8_t *src, uint32_t rows) {
+	uint8_t  r, p, *ptr;
+	uint16_t i;
+	uint32_t w;
+
+	for (r = 0; r < nRows; r++) {
+		if (!(rows & (1UL << r))) {
+			dst += nPlanes * nCols * 2; // Unchanged; skip its words
+			continue;
+		}
+		ptr = &src[r * nCols * (nPlanes - 1)];
+		for (p = 0; p < nPlanes; p++) {
+			for (i = 0; i < nCols; i++) {
+				w = busWord(&ptr[i], p == 0);
+				*dst++ = w;           // Data + clock lo
+				*dst++ = w | sclkpin; // Data + clock hi
+			}
+			if (p > 0) ptr += nCols;
+		}
+	}
+}
 
-	digitalWrite(_oe, LOW);    // Re-enable output
-	digitalWrite(_latch, LOW); // Latch down
-
-    for (i = 0; i < 32; i++) {
-        digitalWrite(_b2, ptr[i] & 0x02);       // 0000 0010
-        digitalWrite(_g2, ptr[i] & 0x01);       // 0000 0001
-        digitalWrite(_r2, ptr[i + 32] & 0x02);  // 0000 0010
-        digitalWrite(_b1, ptr[i + 32] & 0x01);  // 0000 0001
-        digitalWrite(_g1, ptr[i + 64] & 0x02);  // 0000 0010
-        digitalWrite(_r1, ptr[i + 64] & 0x01);  // 0000 0001
-        digitalWrite(_sclk, LOW);
-        digitalWrite(_sclk, HIGH);
-    }
+// Start streaming one row/plane of pre-encoded words into PIO_ODSR.
+// Returns right away; the transfer completes on its own.
+void GoodStuenPanel::dmaRow(uint8_t r, uint8_t p) {
+	DmacCh_num *ch = &DMAC->DMAC_CH_NUM[DMACH];
+
+	DMAC->DMAC_EBCISR;  // Reading clears stale transfer status
+	ch->DMAC_SADDR = halAddr(&dmabuff[(r * nPlanes + p) * nCols * 2]);
+	ch->DMAC_DADDR = halAddr(&databus->PIO_ODSR);
+	ch->DMAC_DSCR  = 0;
+	ch->DMAC_CTRLA = DMAC_CTRLA_BTSIZE(nCols * 2) |
+		DMAC_CTRLA_SRC_WIDTH_WORD | DMAC_CTRLA_DST_WIDTH_WORD;
+	ch->DMAC_CTRLB = DMAC_CTRLB_SRC_DSCR | DMAC_CTRLB_DST_DSCR |
+		DMAC_CTRLB_FC_MEM2MEM_DMA_FC |
+		DMAC_CTRLB_SRC_INCR_INCREMENTING | DMAC_CTRLB_DST_INCR_FIXED;
+	ch->DMAC_CFG   = DMAC_CFG_SOD | DMAC_CFG_AHB_PROT(1) |
+		DMAC_CFG_FIFOCFG_ALAP_CFG;
+	DMAC->DMAC_CHER = DMAC_CHER_ENA0 << DMACH;
 }
 
 /*
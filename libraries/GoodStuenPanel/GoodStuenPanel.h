@@ -1,30 +1,174 @@
-#include "Arduino.h"
+#ifndef _GOODSTUENPANEL_H_
+#define _GOODSTUENPANEL_H_
+
+#include "GoodStuenHal.h"
 #include "Adafruit_GFX.h"
 
+#define MAXPLANES 8 // BCM bit depth limit
+#define MAXCHAINS 5 // Parallel chains: 6 data bits each on a 32-bit PIO
+#define MAXFRAMES 4 // Frame queue depth, including front and back buffers
+#define MAXPHASES 4 // Temporal dither phases (2 dither bits)
+#define ALLROWS   0xFFFFFFFFUL // Dirty row mask with every scan row set
+
+#define MAXROWS   16 // Multiplexed scan rows (32x32 panel)
+#define STATSBINS 8  // Refresh interrupt duration histogram bins
+
+// Trace level for the ring-buffer event log (see drainTrace()); trace
+// points above it compile to nothing.  0 = off, 1 = setup events
+// (begin, calibration, timer and DMA start), 2 = also every refresh
+// interrupt and buffer swap.  The trace points are in GoodStuenPanel.cpp,
+// which the Arduino IDE compiles on its own, so a #define in the sketch
+// doesn't reach them: change the default here, or pass it to every file
+// as a build flag (e.g. compiler.cpp.extra_flags=-DTRACE_LEVEL=2 in
+// platform.local.txt).
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL 0
+#endif
+
+// Trace event ids, with their two arguments:
+enum {
+	TRACE_BEGIN,     // Columns, scan rows
+	TRACE_CALIBRATE, // Call overhead, loop time (timer ticks)
+	TRACE_TIMER,     // Refresh timer started; initial delay, -
+	TRACE_ISR,       // Interrupt entered; row, plane about to be shown
+	TRACE_ISR_END,   // Row shift ticks, interval until next interrupt
+	TRACE_SWAP,      // New front buffer, frames still queued
+	TRACE_DMA        // DMA scan-out enabled; buffer bytes, -
+};
+
+// Frame queue policies for enableQueue():
+#define FRAME_FIFO   0 // Present every frame, in order
+#define FRAME_LATEST 1 // Present the newest frame, dropping stale ones
+
+// Refresh interrupt profile, from getStats().  Durations are CPU cycles
+// from entering the interrupt handler to leaving updateDisplay() (or
+// dimDisplay(), for the brightness cutoff), read from the Cortex-M3 DWT
+// cycle counter.
+struct GoodStuenSpan {
+	uint32_t min, max, mean;
+};
+
+struct GoodStuenStats {
+	uint32_t      interrupts;          // Refresh interrupts sampled
+	GoodStuenSpan all,                 // Every interrupt,
+	              plane[MAXPLANES],    // those loading each bitplane
+	              row[MAXROWS],        // and each scan row
+	              dim;                 // Brightness cutoff interrupts
+	uint32_t      dimInterrupts;       // Of those (none with OE on pin 2)
+	// Per bitplane and per scan row: bin 0 counts interrupts under 256
+	// cycles, bin n 2^(n+7) to 2^(n+8)-1 cycles, and the last bin
+	// anything longer.
+	uint16_t      hist[MAXPLANES][STATSBINS],
+	              rowhist[MAXROWS][STATSBINS];
+	uint16_t      fps;                 // Full refreshes per second achieved
+	uint8_t       cpuLoad;             // Percent of CPU time in interrupts
+	uint32_t      elapsed;             // Milliseconds sampled
+};
+
+// Frame stream (see receiveFrames()): each frame is a 7-byte header --
+// 'G', 'S', a type byte and the payload length, 32 bits little endian --
+// then the payload.
+#define STREAM_RAW   0 // Payload: the whole packed buffer, as backBuffer()
+#define STREAM_DELTA 1 // Payload: changed rows' runs against the last frame
+
+// Frame stream receiver counts, from getStreamStats():
+struct GoodStuenStreamStats {
+	uint32_t frames;  // Frames received and presented
+	uint32_t bytes;   // Bytes taken from the stream, headers included
+	uint32_t errors;  // Frames skipped: unknown type or wrong size
+	uint16_t fps;     // Frames per second received
+	uint32_t bps;     // Bytes per second received
+	uint32_t elapsed; // Milliseconds sampled
+};
+
+// A color encoded once for one panel's packed buffer (see nativeColor()):
+// per dither phase and per run of a row, the bits that color sets.  The
+// upper and lower halves of the panel own different bits of each byte,
+// so one pattern serves both.  Only valid for the panel that encoded it,
+// with the planes and dithering it had at the time.
+struct GoodStuenColor {
+	uint8_t pattern[MAXPHASES][MAXPLANES - 1];
+};
+
 class GoodStuenPanel : public Adafruit_GFX {
 
 public:
 
-	// Constructor for 16x32 panel:
+	// Constructor for 16x32 panel.  'planes' is the BCM bit depth per
+	// color component, 4 to 8.  Chained panels form one canvas of
+	// tilesx by tilesy panels; 'serpentine' if every other row of panels
+	// runs back the other way, mounted upside down.  'chains' parallel
+	// chains of that arrangement, stacked vertically, share the control
+	// lines (see setChainPins()):
 	GoodStuenPanel(uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_t g2, uint8_t b2,
 		uint8_t a, uint8_t b, uint8_t c,
-		uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf);
+		uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf, uint8_t planes = 4,
+		uint8_t tilesx = 1, uint8_t tilesy = 1, boolean serpentine = false,
+		uint8_t chains = 1);
 
 	// Constructor for 32x32 panel (adds 'd' pin):
 	GoodStuenPanel(uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_t g2, uint8_t b2,
 		uint8_t a, uint8_t b, uint8_t c, uint8_t d,
-		uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf);
+		uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf, uint8_t planes = 4,
+		uint8_t tilesx = 1, uint8_t tilesy = 1, boolean serpentine = false,
+		uint8_t chains = 1);
 
 	void
 		begin(void),
 		drawPixel(int16_t x, int16_t y, uint16_t c),
+		drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t c),
+		drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t c),
+		fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t c),
 		fillScreen(uint16_t c),
 		updateDisplay(void),
-        updateDisplay2(void),
+		dimDisplay(void),
+		setBrightness(uint8_t level),
 		swapBuffers(boolean),
-		dumpMatrix(void);
+		requestSwap(void),
+		onSwap(void (*callback)(void)),
+		dumpMatrix(void),
+		updateDMA(void),
+		clearDirty(void),
+		enableStats(boolean on),
+		getStats(GoodStuenStats *stats, boolean reset = false),
+		getStreamStats(GoodStuenStreamStats *stats, boolean reset = false),
+		setChainPins(uint8_t chain, uint8_t r1, uint8_t g1, uint8_t b1,
+			uint8_t r2, uint8_t g2, uint8_t b2),
+		nativeColor(uint16_t c, GoodStuenColor *nc),
+		nativeColor888(uint8_t r, uint8_t g, uint8_t b, boolean gflag,
+			GoodStuenColor *nc),
+		drawPixel(int16_t x, int16_t y, const GoodStuenColor &nc),
+		drawFastHLine(int16_t x, int16_t y, int16_t w, const GoodStuenColor &nc),
+		drawFastVLine(int16_t x, int16_t y, int16_t h, const GoodStuenColor &nc),
+		fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+			const GoodStuenColor &nc),
+		fillScreen(const GoodStuenColor &nc),
+		blit(const uint16_t *src, int16_t x, int16_t y, int16_t w, int16_t h,
+			uint16_t stride = 0),
+		blit(const uint8_t *src, int16_t x, int16_t y, int16_t w, int16_t h,
+			uint16_t stride = 0, boolean gflag = false);
+	boolean
+		setExactTiming(uint16_t unit),
+		swapPending(void),
+		enableQueue(uint8_t frames, uint8_t policy = FRAME_FIFO),
+		enableDither(uint8_t bits),
+		presentFrame(void),
+		receiveFrames(Stream &in),
+		enableDMA(void);
 	uint8_t
 		*backBuffer(void);
+	uint8_t
+		cpuLoad(void);
+	static uint8_t
+		drainTrace(Print &out, uint8_t max = 8);
+	uint16_t
+		refreshRate(void);
+	uint32_t
+		bufferSize(void),
+		rowCycles(void),
+		droppedFrames(void),
+		repeatedFrames(void),
+		dirtyRows(void);
 	uint16_t
 		Color333(uint8_t r, uint8_t g, uint8_t b),
 		Color444(uint8_t r, uint8_t g, uint8_t b),
@@ -32,30 +176,367 @@ public:
 		Color888(uint8_t r, uint8_t g, uint8_t b, boolean gflag),
 		ColorHSV(long hue, uint8_t sat, uint8_t val, boolean gflag);
 
-private:
+protected:
+
+	// Constructor for any geometry, used by the GoodStuenMatrix template
+	// (width = total columns in a straight chain, rows = multiplexed scan
+	// rows):
+	GoodStuenPanel(uint16_t width, uint8_t rows,
+		uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_t g2, uint8_t b2,
+		uint8_t a, uint8_t b, uint8_t c, uint8_t d,
+		uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf, uint8_t planes);
 
-	uint8_t         *matrixbuff[2];
-    uint8_t         *matrixbuff2;
-	uint8_t          nRows;
-	volatile uint8_t backindex;
+	uint8_t         *matrixbuff[MAXFRAMES];
+	uint16_t         nCols;
+	uint8_t          nRows, nPlanes;
+	uint8_t          tilesX, tilesY, nChains;
+	boolean          zigzag;
+	uint32_t         chainStride, buffsize; // Bytes per chain, per frame
+	volatile uint8_t backindex, frontindex;
 	volatile boolean swapflag;
+	void           (*swapcallback)(void);
+
+	// Frame queue: buffer count, policy, ring of presented buffer indices
+	// (oldest at qhead), most recently presented, counters:
+	uint8_t           nFrames, qpolicy, lastindex;
+	volatile uint8_t  fqueue[MAXFRAMES], qhead, qcount;
+	volatile uint32_t dropped, repeated;
+
+	// Scan rows drawn into since the back buffer was last presented, and
+	// per buffer, rows that may differ from the newest presented frame:
+	uint32_t dirty, stale[MAXFRAMES];
+	void     foldDirty(void),
+	         copyRows(uint8_t *dst, const uint8_t *src, uint32_t rows),
+	         syncBackBuffer(void);
 
 	// Init/alloc code common to both constructors:
 	void init(uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_t g2, uint8_t b2,
-		uint8_t rows, uint8_t a, uint8_t b, uint8_t c,
-		uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf);
+		uint16_t cols, uint8_t rows, uint8_t a, uint8_t b, uint8_t c,
+		uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf, uint8_t planes,
+		uint8_t tilesx, uint8_t tilesy, boolean serpentine, uint8_t chains);
 
-	// PORT register pointers, pin bitmasks, pin numbers:
-	/*volatile long unsigned int
-	  *sclkport, *latport, *oeport, *addraport, *addrbport, *addrcport, *addrdport;*/
-	uint8_t
+	// Temporal dithering (see enableDither()): extra bits of color depth,
+	// copies of the packed image per frame, bytes in each, and the copy
+	// on display:
+	uint8_t          ditherBits, nPhases;
+	uint32_t         phaseSize;
+	volatile uint8_t frcphase;
+
+	// Canvas to chain coordinates for tiled layouts and parallel chains,
+	// and a rotated pixel's first packed byte:
+	uint32_t mapPixel(int16_t &x, int16_t &y);
+	uint8_t *pixelBytes(int16_t x, int16_t y, const uint8_t **bits);
+
+	// 5/6/5 color to top nPlanes bits per component, for dither phase k;
+	// phase k's share of nPlanes + ditherBits bit components:
+	void decodeColor(uint16_t c, uint8_t k, uint8_t &r, uint8_t &g, uint8_t &b),
+	     phaseLevels(uint8_t k, uint8_t &r, uint8_t &g, uint8_t &b);
+
+	// Gamma tables for this color depth, as 5/6/5 fields:
+	const uint8_t *gammaR, *gammaG, *gammaB;
+	void           selectGamma(uint8_t depth);
+
+	// Native encoding of the last 5/6/5 color drawn, cached:
+	uint16_t       fillcolor;
+	boolean        fillvalid;
+	GoodStuenColor fillnative;
+	void           setFillColor(uint16_t c),
+	               packLevels(uint8_t r, uint8_t g, uint8_t b, uint8_t *pattern),
+	               fillChainRect(uint32_t base, int16_t x, int16_t y, int16_t w, int16_t h,
+	                 const uint8_t *pattern);
+
+	// Bulk upload (see blit()): one of src565/src888 is used, and groups
+	// of four pixels' levels are bit-sliced into the buffer a word at a
+	// time, one half's row or both halves' at once:
+	void blitRect(const uint16_t *src565, const uint8_t *src888,
+	       int16_t x, int16_t y, int16_t w, int16_t h, uint16_t stride, boolean gflag),
+	     decodeGroup(const uint16_t *src565, const uint8_t *src888,
+	       const uint8_t *lv, boolean gflag, int32_t at, int32_t step, uint8_t m,
+	       uint32_t *w),
+	     phaseWords(uint8_t k, uint32_t &rw, uint32_t &gw, uint32_t &bw),
+	     packGroup(uint8_t *ptr, uint8_t half, uint8_t k, const uint32_t *w,
+	       uint8_t m),
+	     packPair(uint8_t *ptr, uint8_t k, const uint32_t *u, const uint32_t *l,
+	       uint8_t m);
+
+	// Frame stream receiver (see receiveFrames()): where it is in the
+	// current frame, that frame's type, payload bytes still to come and
+	// already stored (raw) or the position in the current row (delta),
+	// counters since the stats were last reset, and for deltas, rows
+	// still to come, the current row and bytes left in the current run.
+	// Whether the back buffer has been made ready for this frame, and
+	// whether frames received so far leave deltas something to apply to:
+	enum {
+		RX_MAGIC0, RX_MAGIC1, RX_TYPE, RX_LENGTH, // + 0 to 3: length bytes
+		RX_PAYLOAD = RX_LENGTH + 4, RX_MASK,      // + 0 to 3: row mask bytes
+		RX_OP = RX_MASK + 4, RX_LITERAL, RX_VALUE, RX_SKIP, RX_PRESENT
+	};
+	uint8_t  rxstate, rxtype;
+	uint32_t rxleft, rxpos;
+	uint32_t rxframes, rxbytes, rxerrors, rxstart;
+	uint32_t rxmask;
+	uint8_t  rxrow, rxrun;
+	boolean  rxready, rxsynced;
+	uint8_t *rxPointer(uint32_t &room);
+	void     nextRun(void),
+	         rxAbort(void);
+
+	// PIO controller pointers, pin bitmasks, pin numbers:
+	Pio
+		*r1port, *g1port, *b1port, *r2port, *g2port, *b2port,
+		*sclkport, *latport, *oeport, *addraport, *addrbport, *addrcport, *addrdport;
+	uint32_t
+		r1pin, g1pin, b1pin, r2pin, g2pin, b2pin,
 		sclkpin, latpin, oepin, addrapin, addrbpin, addrcpin, addrdpin;
-	// _sclk, _latch, _oe, _a, _b, _c, _d, _r1, _g1, _b1, _r2, _g2, _b2;
+	uint8_t
+		_sclk, _latch, _oe, _a, _b, _c, _d, _r1, _g1, _b1, _r2, _g2, _b2;
+
+	// Parallel data bus (NULL if data pins aren't on one PIO in order),
+	// number of chains driven through it, each chain's data pins (bit k
+	// of chainset: chain k's were given) and the shifts lining its
+	// packed buffer bits up with the port bits:
+	Pio    *databus;
+	uint8_t busChains;
+	uint8_t chainpins[MAXCHAINS][6], chainset;
+	uint8_t busls[MAXCHAINS], busrs[MAXCHAINS];
+	uint32_t busWord(const uint8_t *ptr, boolean plane0);
 
 	// Counters/pointers for interrupt handler:
 	volatile uint8_t row, plane;
 	volatile uint8_t *buffptr;
+	volatile uint32_t rowticks; // Timer ticks spent shifting out last row
+
+	// Measured BCM timing, in timer ticks: interrupt entry overhead and
+	// time to shift out one row of one plane (see calibrate()):
+	uint32_t          callOverhead, loopTime;
+	volatile boolean  calibrating;
+
+	// Global brightness (0-255), whether OE is driven by TIOA0, and the
+	// plane 0 on time for exact timing (0 = off):
+	volatile uint8_t  brightness;
+	boolean           hwoe;
+	volatile uint32_t onunit;
+	volatile uint32_t entryticks;
+	void              calibrate(void);
+
+	// Refresh interrupt profiling (see enableStats()): per plane and per
+	// row accumulators, duration histograms, refreshes and start time:
+	struct StatsAcc {
+		uint32_t min, max, count;
+		uint64_t sum;
+	};
+	volatile boolean statson;
+	StatsAcc         planeacc[MAXPLANES], rowacc[MAXROWS], dimacc;
+	uint16_t         hist[MAXPLANES][STATSBINS], rowhist[MAXROWS][STATSBINS];
+	uint32_t         statsframes, statsstart;
+	void             recordStats(uint32_t cycles),
+	                 resetStats(void);
 
 	void startTimerCounter();
+	virtual void shiftRow(uint8_t *ptr, uint8_t plane);
+
+	// Pre-encoded PIO_ODSR words for DMA scan-out (NULL if not in use),
+	// and when double-buffered, the next frame's, swapped in alongside
+	// the packed buffers:
+	uint32_t *dmabuff, *dmaback;
+	void encodeFrame(uint32_t *dst, uint8_t *src, uint32_t rows);
+	void dmaRow(uint8_t r, uint8_t p);
+};
+
+// Compile-time loop: calls op.col<I>() for I = 0 to N-1, fully unrolled
+// regardless of the optimization level the IDE compiles with.
+template <uint16_t N> struct GoodStuenUnroll {
+	template <class Op> static inline __attribute__((always_inline))
+	void run(const Op &op) {
+		GoodStuenUnroll<N - 1>::run(op);
+		op.template col<N - 1>();
+	}
+};
+template <> struct GoodStuenUnroll<0> {
+	template <class Op> static inline __attribute__((always_inline))
+	void run(const Op &) { }
 };
 
+// GoodStuenPanel with the geometry fixed at compile time: W columns in
+// a straight chain (32 per panel), ROWS multiplexed scan rows (8 for 16x32, 16
+// for 32x32) and PLANES bits of BCM depth.  Buffer offsets, loop bounds
+// and masks all become constants, drawPixel() loses its runtime
+// multiplies, and the interrupt's shift loops are completely unrolled.
+// Everything else (begin(), buffers, DMA, colors) is shared with the
+// runtime class.
+template <uint16_t W, uint8_t ROWS, uint8_t PLANES>
+class GoodStuenMatrix : public GoodStuenPanel {
+
+	static_assert((W > 0) && !(W & 31), "Width must be a multiple of 32");
+	static_assert((ROWS == 8) || (ROWS == 16), "Scan rows must be 8 or 16");
+	static_assert((PLANES >= 4) && (PLANES <= 8), "Planes must be 4 to 8");
+
+public:
+
+	// Constructor for 16x32-style panels (no 'd' pin):
+	GoodStuenMatrix(uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_t g2, uint8_t b2,
+		uint8_t a, uint8_t b, uint8_t c,
+		uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf) :
+		GoodStuenPanel(W, ROWS, r1, g1, b1, r2, g2, b2, a, b, c, 0,
+			sclk, latch, oe, dbuf, PLANES) {
+		static_assert(ROWS == 8, "16 scan rows need the 'd' pin constructor");
+	}
+
+	// Constructor for 32x32-style panels (adds 'd' pin):
+	GoodStuenMatrix(uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_t g2, uint8_t b2,
+		uint8_t a, uint8_t b, uint8_t c, uint8_t d,
+		uint8_t sclk, uint8_t latch, uint8_t oe, boolean dbuf) :
+		GoodStuenPanel(W, ROWS, r1, g1, b1, r2, g2, b2, a, b, c, d,
+			sclk, latch, oe, dbuf, PLANES) { }
+
+	using GoodStuenPanel::drawPixel; // Keep the native color version
+	void drawPixel(int16_t x, int16_t y, uint16_t c);
+
+protected:
+
+	void shiftRow(uint8_t *ptr, uint8_t plane);
+
+private:
+
+	// Per-column operations for the unrolled shift loops.  Pin data is
+	// copied into the op so it can live in registers, rather than being
+	// reloaded from the object after every (volatile) port write.
+	template <boolean PLANE0, boolean CLKONBUS> struct BusOp {
+		Pio           *bus, *clk;
+		uint32_t       clkpin;
+		const uint8_t *ptr;
+		uint8_t        lshift, rshift;
+		template <uint16_t I> inline __attribute__((always_inline))
+		void col() const {
+			uint32_t d = PLANE0 ?
+				(((ptr[I] << 6) & 0xC0) | ((ptr[I + W] << 4) & 0x30) |
+				 ((ptr[I + W * 2] << 2) & 0x0C)) : (ptr[I] & 0xFC);
+			if (!CLKONBUS) clk->PIO_CODR = clkpin;
+			bus->PIO_ODSR = (d << lshift) >> rshift;
+			clk->PIO_SODR = clkpin;
+		}
+	};
+	template <boolean PLANE0> struct PinOp {
+		Pio           *r1p, *g1p, *b1p, *r2p, *g2p, *b2p, *clk;
+		uint32_t       r1m, g1m, b1m, r2m, g2m, b2m, clkpin;
+		const uint8_t *ptr;
+		static inline __attribute__((always_inline))
+		void out(Pio *port, uint32_t pin, uint8_t bit) {
+			if (bit) port->PIO_SODR = pin;
+			else     port->PIO_CODR = pin;
+		}
+		template <uint16_t I> inline __attribute__((always_inline))
+		void col() const {
+			if (PLANE0) {
+				out(b2p, b2m, ptr[I] & 0x02);
+				out(g2p, g2m, ptr[I] & 0x01);
+				out(r2p, r2m, ptr[I + W] & 0x02);
+				out(b1p, b1m, ptr[I + W] & 0x01);
+				out(g1p, g1m, ptr[I + W * 2] & 0x02);
+				out(r1p, r1m, ptr[I + W * 2] & 0x01);
+			} else {
+				out(b2p, b2m, ptr[I] & 0x80);
+				out(g2p, g2m, ptr[I] & 0x40);
+				out(r2p, r2m, ptr[I] & 0x20);
+				out(b1p, b1m, ptr[I] & 0x10);
+				out(g1p, g1m, ptr[I] & 0x08);
+				out(r1p, r1m, ptr[I] & 0x04);
+			}
+			clk->PIO_CODR = clkpin;
+			clk->PIO_SODR = clkpin;
+		}
+	};
+
+	template <boolean PLANE0, boolean CLKONBUS>
+	inline void shiftBus(uint8_t *ptr) {
+		BusOp<PLANE0, CLKONBUS> op = {
+			databus, sclkport, sclkpin, ptr, busls[0], busrs[0] };
+		GoodStuenUnroll<W>::run(op);
+	}
+	template <boolean PLANE0>
+	inline void shiftPins(uint8_t *ptr) {
+		PinOp<PLANE0> op = {
+			r1port, g1port, b1port, r2port, g2port, b2port, sclkport,
+			r1pin, g1pin, b1pin, r2pin, g2pin, b2pin, sclkpin, ptr };
+		GoodStuenUnroll<W>::run(op);
+	}
+};
+
+template <uint16_t W, uint8_t ROWS, uint8_t PLANES>
+void GoodStuenMatrix<W, ROWS, PLANES>::shiftRow(uint8_t *ptr, uint8_t plane) {
+	if (databus) {
+		if (sclkport == databus) {
+			if (plane == 0) shiftBus<true,  true>(ptr);
+			else            shiftBus<false, true>(ptr);
+		} else {
+			if (plane == 0) shiftBus<true,  false>(ptr);
+			else            shiftBus<false, false>(ptr);
+		}
+	} else {
+		if (plane == 0) shiftPins<true>(ptr);
+		else            shiftPins<false>(ptr);
+	}
+}
+
+// Same packing as GoodStuenPanel::drawPixel(), with constant offsets and
+// the per-plane bit tests folded into shifts.
+template <uint16_t W, uint8_t ROWS, uint8_t PLANES>
+void GoodStuenMatrix<W, ROWS, PLANES>::drawPixel(int16_t x, int16_t y, uint16_t c) {
+	uint8_t r, g, b, p, s, *ptr;
+
+	if ((x < 0) || (x >= _width) || (y < 0) || (y >= _height)) return;
+	if (ditherBits) {
+		// One packed copy per dither phase; leave that to the general case
+		GoodStuenPanel::drawPixel(x, y, c);
+		return;
+	}
+
+	switch (rotation) {
+	case 1:
+		swap(x, y);
+		x = W - 1 - x;
+		break;
+	case 2:
+		x = W - 1 - x;
+		y = ROWS * 2 - 1 - y;
+		break;
+	case 3:
+		swap(x, y);
+		y = ROWS * 2 - 1 - y;
+		break;
+	}
+
+	// 5/6/5 -> 8 bits per component -> top PLANES bits
+	r = (((c >> 8) & 0xF8) | (c >> 13)) >> (8 - PLANES);
+	g = (((c >> 3) & 0xFC) | ((c >> 9) & 0x03)) >> (8 - PLANES);
+	b = (((c << 3) & 0xF8) | ((c >> 2) & 0x07)) >> (8 - PLANES);
+
+	if (y < ROWS) {
+		// Upper half: plane 0 R,G in bits 0,1 two runs ahead, B in bit 0
+		// one run ahead; other planes in bits 2-4.
+		dirty |= 1UL << y;
+		ptr = &matrixbuff[backindex][y * W * (PLANES - 1) + x];
+		ptr[W * 2] = (ptr[W * 2] & ~B00000011) | (r & 1) | ((g & 1) << 1);
+		ptr[W]     = (ptr[W]     & ~B00000001) | (b & 1);
+		s = 2;
+	} else {
+		// Lower half: plane 0 G,B in bits 0,1, R in bit 1 one run ahead;
+		// other planes in bits 5-7.
+		dirty |= 1UL << (y - ROWS);
+		ptr = &matrixbuff[backindex][(y - ROWS) * W * (PLANES - 1) + x];
+		ptr[0] = (ptr[0] & ~B00000011) | (g & 1) | ((b & 1) << 1);
+		ptr[W] = (ptr[W] & ~B00000010) | ((r & 1) << 1);
+		s = 5;
+	}
+	for (p = 1; p < PLANES; p++) {
+		*ptr = (*ptr & ~(7 << s)) |
+			((((r >> p) & 1) | (((g >> p) & 1) << 1) | (((b >> p) & 1) << 2)) << s);
+		ptr += W;
+	}
+}
+
+// The original single-panel geometries, with 4 planes:
+typedef GoodStuenMatrix<32,  8, 4> GoodStuenPanel16x32;
+typedef GoodStuenMatrix<32, 16, 4> GoodStuenPanel32x32;
+
+#endif // _GOODSTUENPANEL_H_
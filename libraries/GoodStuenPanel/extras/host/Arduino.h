@@ -0,0 +1,284 @@
+// Arduino Due core stand-in for building GoodStuenPanel, and sketches
+// using it, on Linux.  NOT ARDUINO CODE -- see README.txt.
+// Covers what the library and its sketches use: the Arduino API basics,
+// Serial, and the SAM3X peripherals behind GoodStuenHal.h.  PIO
+// controllers and TC0 are objects whose registers hand every access to
+// the emulator (hub75emu.cpp), which tracks pin levels, runs the timer
+// in virtual time and delivers TC0_Handler() from its own thread.
+
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "binary.h"
+#include "Print.h"
+
+#define GOODSTUEN_HOST 1
+#ifndef ARDUINO
+#define ARDUINO 10605 // As the IDE would pass
+#endif
+
+typedef bool    boolean;
+typedef uint8_t byte;
+
+#define HIGH   1
+#define LOW    0
+#define INPUT  0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define PROGMEM
+#define F(s)   (s)
+#define pgm_read_byte(addr) (*(const unsigned char *)(addr))
+#define pgm_read_word(addr) (*(const unsigned short *)(addr))
+
+#define VARIANT_MCK 84000000UL
+#define F_CPU       VARIANT_MCK
+
+using std::min;
+using std::max;
+#define constrain(x, lo, hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+void     pinMode(uint32_t pin, uint32_t mode);
+void     digitalWrite(uint32_t pin, uint32_t val);
+int      digitalRead(uint32_t pin);
+void     delay(uint32_t ms);
+void     delayMicroseconds(uint32_t us);
+uint32_t millis(void);
+uint32_t micros(void);
+long     random(long howbig);
+long     random(long howsmall, long howbig);
+void     randomSeed(unsigned long seed);
+
+void setup(void);
+void loop(void);
+
+// -------------------- Interrupts --------------------
+
+// PRIMASK: while set, the emulator holds back the timer interrupt.
+void     __disable_irq(void);
+void     __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void     __set_PRIMASK(uint32_t mask);
+void     __DMB(void);
+#define noInterrupts() __disable_irq()
+#define interrupts()   __enable_irq()
+
+typedef enum { TC0_IRQn = 27, DMAC_IRQn = 39 } IRQn_Type;
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+void NVIC_ClearPendingIRQ(IRQn_Type irq);
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+
+extern "C" void TC0_Handler(void);
+
+#define ID_TC0  27
+#define ID_DMAC 39
+void pmc_set_writeprotect(uint32_t enable);
+void pmc_enable_periph_clk(uint32_t id);
+
+// -------------------- PIO --------------------
+
+struct Pio;
+struct TcChannel;
+
+// Register R of a PIO controller or timer channel.  Stores and loads go
+// to the emulator; the containing object is found from the offset.
+enum {
+	PIO_REG_PER, PIO_REG_PDR, PIO_REG_PSR, PIO_REG_OER, PIO_REG_ODR,
+	PIO_REG_OSR, PIO_REG_SODR, PIO_REG_CODR, PIO_REG_ODSR, PIO_REG_PDSR,
+	PIO_REG_ABSR, PIO_REG_OWER, PIO_REG_OWDR, PIO_REG_OWSR, PIO_REGS
+};
+enum {
+	TC_REG_CCR, TC_REG_CMR, TC_REG_SMMR, TC_REG_CV, TC_REG_RA, TC_REG_RB,
+	TC_REG_RC, TC_REG_SR, TC_REG_IER, TC_REG_IDR, TC_REG_IMR, TC_REGS
+};
+
+void     emuPioWrite(Pio *pio, uint8_t reg, uint32_t value);
+uint32_t emuPioRead(const Pio *pio, uint8_t reg);
+void     emuTcWrite(TcChannel *ch, uint8_t reg, uint32_t value);
+uint32_t emuTcRead(const TcChannel *ch, uint8_t reg);
+
+template <uint8_t R> struct PioReg {
+	uint32_t value;
+	Pio *pio() const { return (Pio *)((char *)this - R * sizeof(*this)); }
+	PioReg &operator=(uint32_t v) { emuPioWrite(pio(), R, v); return *this; }
+	operator uint32_t() const     { return emuPioRead(pio(), R); }
+};
+template <uint8_t R> struct TcReg {
+	uint32_t value;
+	TcChannel *ch() const { return (TcChannel *)((char *)this - R * sizeof(*this)); }
+	TcReg &operator=(uint32_t v) { emuTcWrite(ch(), R, v); return *this; }
+	operator uint32_t() const    { return emuTcRead(ch(), R); }
+};
+
+struct Pio {
+	PioReg<PIO_REG_PER>  PIO_PER;
+	PioReg<PIO_REG_PDR>  PIO_PDR;
+	PioReg<PIO_REG_PSR>  PIO_PSR;
+	PioReg<PIO_REG_OER>  PIO_OER;
+	PioReg<PIO_REG_ODR>  PIO_ODR;
+	PioReg<PIO_REG_OSR>  PIO_OSR;
+	PioReg<PIO_REG_SODR> PIO_SODR;
+	PioReg<PIO_REG_CODR> PIO_CODR;
+	PioReg<PIO_REG_ODSR> PIO_ODSR;
+	PioReg<PIO_REG_PDSR> PIO_PDSR;
+	PioReg<PIO_REG_ABSR> PIO_ABSR;
+	PioReg<PIO_REG_OWER> PIO_OWER;
+	PioReg<PIO_REG_OWDR> PIO_OWDR;
+	PioReg<PIO_REG_OWSR> PIO_OWSR;
+};
+
+extern Pio *const PIOA, *const PIOB, *const PIOC, *const PIOD;
+
+typedef enum {
+	PIO_NOT_A_PIN, PIO_PERIPH_A, PIO_PERIPH_B, PIO_INPUT, PIO_OUTPUT_0,
+	PIO_OUTPUT_1
+} EPioType;
+#define PIO_DEFAULT 0
+#define PIO_PB25B_TIOA0 (1u << 25)
+void PIO_Configure(Pio *pio, EPioType type, uint32_t mask, uint32_t attribute);
+
+// Due pin numbers to PIO controller and bitmask, as in variant.cpp:
+struct PinDescription {
+	Pio     *pPort;
+	uint32_t ulPin;
+};
+extern const PinDescription g_APinDescription[];
+
+// -------------------- TC --------------------
+
+struct TcChannel {
+	TcReg<TC_REG_CCR>  TC_CCR;
+	TcReg<TC_REG_CMR>  TC_CMR;
+	TcReg<TC_REG_SMMR> TC_SMMR;
+	TcReg<TC_REG_CV>   TC_CV;
+	TcReg<TC_REG_RA>   TC_RA;
+	TcReg<TC_REG_RB>   TC_RB;
+	TcReg<TC_REG_RC>   TC_RC;
+	TcReg<TC_REG_SR>   TC_SR;
+	TcReg<TC_REG_IER>  TC_IER;
+	TcReg<TC_REG_IDR>  TC_IDR;
+	TcReg<TC_REG_IMR>  TC_IMR;
+};
+struct Tc {
+	TcChannel TC_CHANNEL[3];
+};
+extern Tc *const TC0;
+
+#define TC_CCR_CLKEN  (1u << 0)
+#define TC_CCR_CLKDIS (1u << 1)
+#define TC_CCR_SWTRG  (1u << 2)
+#define TC_CMR_TCCLKS_TIMER_CLOCK1 0
+#define TC_CMR_CPCSTOP      (1u << 6)
+#define TC_CMR_WAVSEL_UP    (0u << 13)
+#define TC_CMR_WAVSEL_UP_RC (2u << 13)
+#define TC_CMR_WAVSEL_Msk   (3u << 13)
+#define TC_CMR_WAVE         (1u << 15)
+#define TC_CMR_ACPA_SET     (1u << 16)
+#define TC_CMR_ACPA_CLEAR   (2u << 16)
+#define TC_CMR_ACPA_Msk     (3u << 16)
+#define TC_CMR_ACPC_SET     (1u << 18)
+#define TC_CMR_ACPC_CLEAR   (2u << 18)
+#define TC_CMR_ACPC_Msk     (3u << 18)
+#define TC_CMR_ASWTRG_SET   (1u << 22)
+#define TC_CMR_ASWTRG_CLEAR (2u << 22)
+#define TC_CMR_ASWTRG_Msk   (3u << 22)
+#define TC_SR_CPAS  (1u << 2)
+#define TC_SR_CPCS  (1u << 4)
+#define TC_IER_CPAS TC_SR_CPAS
+#define TC_IER_CPCS TC_SR_CPCS
+#define TC_IDR_CPAS TC_SR_CPAS
+#define TC_IDR_CPCS TC_SR_CPCS
+
+// As in the core's tc.c:
+static inline void TC_Configure(Tc *tc, uint32_t ch, uint32_t mode) {
+	tc->TC_CHANNEL[ch].TC_CCR = TC_CCR_CLKDIS;
+	tc->TC_CHANNEL[ch].TC_IDR = 0xFFFFFFFF;
+	(void)(uint32_t)tc->TC_CHANNEL[ch].TC_SR; // Clear status
+	tc->TC_CHANNEL[ch].TC_CMR = mode;
+}
+static inline void TC_Start(Tc *tc, uint32_t ch) {
+	tc->TC_CHANNEL[ch].TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
+}
+static inline void TC_Stop(Tc *tc, uint32_t ch) {
+	tc->TC_CHANNEL[ch].TC_CCR = TC_CCR_CLKDIS;
+}
+static inline void TC_SetRA(Tc *tc, uint32_t ch, uint32_t v) { tc->TC_CHANNEL[ch].TC_RA = v; }
+static inline void TC_SetRB(Tc *tc, uint32_t ch, uint32_t v) { tc->TC_CHANNEL[ch].TC_RB = v; }
+static inline void TC_SetRC(Tc *tc, uint32_t ch, uint32_t v) { tc->TC_CHANNEL[ch].TC_RC = v; }
+static inline uint32_t TC_GetStatus(Tc *tc, uint32_t ch) {
+	return tc->TC_CHANNEL[ch].TC_SR;
+}
+
+// -------------------- DMAC, DWT --------------------
+
+// Register file only; nothing is transferred (HAL_HAS_DMA is 0).
+struct DmacCh_num {
+	volatile uint32_t DMAC_SADDR, DMAC_DADDR, DMAC_DSCR, DMAC_CTRLA,
+		DMAC_CTRLB, DMAC_CFG, DMAC_SPIP, DMAC_DPIP, reserved[2];
+};
+struct Dmac {
+	volatile uint32_t DMAC_GCFG, DMAC_EN, DMAC_SREQ, DMAC_CREQ, DMAC_LAST,
+		reserved0, DMAC_EBCIER, DMAC_EBCIDR, DMAC_EBCIMR, DMAC_EBCISR,
+		DMAC_CHER, DMAC_CHDR, DMAC_CHSR, reserved1[2];
+	DmacCh_num DMAC_CH_NUM[6];
+};
+extern Dmac *const DMAC;
+#define DMAC_GCFG_ARB_CFG_ROUND_ROBIN (1u << 4)
+#define DMAC_EN_ENABLE    (1u << 0)
+#define DMAC_CHER_ENA0    (1u << 0)
+#define DMAC_CHDR_DIS0    (1u << 0)
+#define DMAC_CHSR_ENA0    (1u << 0)
+#define DMAC_CTRLA_BTSIZE(n)           ((uint32_t)(n) & 0xFFFF)
+#define DMAC_CTRLA_SRC_WIDTH_WORD      (2u << 24)
+#define DMAC_CTRLA_DST_WIDTH_WORD      (2u << 28)
+#define DMAC_CTRLB_SRC_DSCR            (1u << 16)
+#define DMAC_CTRLB_DST_DSCR            (1u << 20)
+#define DMAC_CTRLB_FC_MEM2MEM_DMA_FC   (0u << 21)
+#define DMAC_CTRLB_SRC_INCR_INCREMENTING (0u << 24)
+#define DMAC_CTRLB_DST_INCR_FIXED      (2u << 28)
+#define DMAC_CFG_SOD                   (1u << 16)
+#define DMAC_CFG_AHB_PROT(n)           ((uint32_t)(n) << 24)
+#define DMAC_CFG_FIFOCFG_ALAP_CFG      (0u << 28)
+
+// CYCCNT reads the emulator's virtual CPU cycle count.
+uint32_t emuCycles(void);
+struct DwtCycles {
+	operator uint32_t() const    { return emuCycles(); }
+	DwtCycles &operator=(uint32_t) { return *this; }
+};
+struct DWT_Type {
+	volatile uint32_t CTRL;
+	DwtCycles         CYCCNT;
+};
+struct CoreDebug_Type {
+	volatile uint32_t DEMCR;
+};
+extern DWT_Type       *const DWT;
+extern CoreDebug_Type *const CoreDebug;
+#define DWT_CTRL_CYCCNTENA_Msk      (1u << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1u << 24)
+
+// -------------------- Serial --------------------
+
+// stdout for output; input from stdin when it's a pipe or file.
+class HostSerial : public Stream {
+public:
+	void   begin(unsigned long) { }
+	void   end(void) { }
+	size_t write(uint8_t c);
+	using  Print::write;
+	int    available(void);
+	int    read(void);
+	int    peek(void);
+	void   flush(void);
+	operator bool() { return true; }
+};
+extern HostSerial Serial, SerialUSB;
+
+#endif // _HOST_ARDUINO_H_
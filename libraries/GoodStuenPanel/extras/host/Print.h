@@ -0,0 +1,105 @@
+// Print and Stream base classes for the Linux host build, with the same
+// interface as the Arduino core's (number bases, float digits, println).
+// NOT ARDUINO CODE -- see README.txt.
+
+#ifndef _HOST_PRINT_H_
+#define _HOST_PRINT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print {
+public:
+	virtual ~Print() { }
+	virtual size_t write(uint8_t) = 0;
+	virtual size_t write(const uint8_t *buf, size_t n) {
+		size_t i;
+		for (i = 0; (i < n) && write(buf[i]); i++);
+		return i;
+	}
+	size_t write(const char *s) {
+		return s ? write((const uint8_t *)s, strlen(s)) : 0;
+	}
+	size_t write(const char *buf, size_t n) {
+		return write((const uint8_t *)buf, n);
+	}
+
+	size_t print(const char *s)                  { return write(s); }
+	size_t print(char c)                         { return write((uint8_t)c); }
+	size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+	size_t print(int n, int base = DEC)          { return print((long)n, base); }
+	size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+	size_t print(long n, int base = DEC) {
+		if ((base == DEC) && (n < 0)) return print('-') + printNumber(-(unsigned long)n, DEC);
+		return printNumber((unsigned long)n, base);
+	}
+	size_t print(unsigned long n, int base = DEC) { return printNumber(n, base); }
+	size_t print(double n, int digits = 2)        { return printFloat(n, digits); }
+
+	size_t println(void)                           { return write("\r\n"); }
+	size_t println(const char *s)                  { return print(s) + println(); }
+	size_t println(char c)                         { return print(c) + println(); }
+	size_t println(unsigned char n, int base = DEC) { return print(n, base) + println(); }
+	size_t println(int n, int base = DEC)          { return print(n, base) + println(); }
+	size_t println(unsigned int n, int base = DEC) { return print(n, base) + println(); }
+	size_t println(long n, int base = DEC)         { return print(n, base) + println(); }
+	size_t println(unsigned long n, int base = DEC) { return print(n, base) + println(); }
+	size_t println(double n, int digits = 2)       { return print(n, digits) + println(); }
+
+private:
+	size_t printNumber(unsigned long n, uint8_t base) {
+		char buf[8 * sizeof(long) + 1], *s = &buf[sizeof(buf) - 1];
+		*s = 0;
+		if (base < 2) base = 10;
+		do {
+			uint8_t d = n % base;
+			n /= base;
+			*--s = (d < 10) ? ('0' + d) : ('A' + d - 10);
+		} while (n);
+		return write(s);
+	}
+	size_t printFloat(double n, uint8_t digits) {
+		size_t   len = 0;
+		double   rounding = 0.5;
+		unsigned long whole;
+		uint8_t  i;
+
+		if (n != n) return print("nan");
+		if (n < 0.0) {
+			len += print('-');
+			n = -n;
+		}
+		for (i = 0; i < digits; i++) rounding /= 10.0;
+		n    += rounding;
+		whole = (unsigned long)n;
+		n    -= (double)whole;
+		len  += print(whole);
+		if (digits) len += print('.');
+		while (digits--) {
+			n *= 10.0;
+			len += print((unsigned int)n % 10);
+		}
+		return len;
+	}
+};
+
+class Stream : public Print {
+public:
+	Stream() : timeout(1000) { }
+	virtual int available(void) = 0;
+	virtual int read(void) = 0;
+	virtual int peek(void) = 0;
+	void   setTimeout(unsigned long ms) { timeout = ms; }
+	size_t readBytes(uint8_t *buf, size_t n);
+	size_t readBytes(char *buf, size_t n) { return readBytes((uint8_t *)buf, n); }
+protected:
+	unsigned long timeout;
+};
+
+#endif // _HOST_PRINT_H_
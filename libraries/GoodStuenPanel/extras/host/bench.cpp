@@ -0,0 +1,247 @@
+// Drawing benchmark for the Linux host build.
+// NOT ARDUINO CODE -- see README.txt.
+//
+//   ./bench [-t seconds] [-p planes] [-d ditherbits]
+//
+// Runs every Adafruit_GFX primitive against three 32x32 targets: the
+// runtime GoodStuenPanel, the compile-time GoodStuenPanel32x32, and a
+// flat 16-bit canvas that only implements drawPixel() (the reference:
+// what the generic GFX code costs with a trivial encoder).  Each test
+// replays the same 1024 calls, with varying positions, sizes and
+// colors, for 't' seconds per target (default 0.2).  Reports calls per
+// second and millions of pixels per second, counting pixels as the
+// generic GFX code would plot them.  Then uploads whole frames of
+// random pixels, a pixel at a time and with blit().  Host numbers don't
+// translate to the Due, but their ratios do show where a change sped up
+// or slowed down the drawing path.  -p and -d configure the runtime
+// panel only.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include "Arduino.h"
+#include "GoodStuenPanel.h"
+
+#define W     32
+#define H     32
+#define CALLS 1024 // Distinct calls per test, replayed
+
+// Reference target: plain array, every primitive goes through drawPixel().
+class FlatCanvas : public Adafruit_GFX {
+public:
+	FlatCanvas() : Adafruit_GFX(W, H) { }
+	void drawPixel(int16_t x, int16_t y, uint16_t c) {
+		if ((x >= 0) && (y >= 0) && (x < W) && (y < H)) buf[y * W + x] = c;
+	}
+	uint16_t buf[W * H];
+};
+
+// Pixel counter, to size each test the same way for all targets.
+class CountCanvas : public Adafruit_GFX {
+public:
+	CountCanvas() : Adafruit_GFX(W, H), n(0) { }
+	void drawPixel(int16_t x, int16_t y, uint16_t) {
+		if ((x >= 0) && (y >= 0) && (x < W) && (y < H)) n++;
+	}
+	uint64_t n;
+};
+
+static const uint8_t PROGMEM bitmap[] = { // 16x16 ring
+	0x07,0xe0, 0x1f,0xf8, 0x3c,0x3c, 0x70,0x0e, 0x60,0x06, 0xe0,0x07,
+	0xc0,0x03, 0xc0,0x03, 0xc0,0x03, 0xc0,0x03, 0xe0,0x07, 0x60,0x06,
+	0x70,0x0e, 0x3c,0x3c, 0x1f,0xf8, 0x07,0xe0 };
+
+static const uint16_t colors[8] = {
+	0xffff, 0xf800, 0x07e0, 0x001f, 0xffe0, 0xf81f, 0x07ff, 0x8410 };
+
+// Call i's arguments: coordinates from -4 to W+3 so some clip, sizes
+// 1 to 16, one of eight colors.
+static inline int16_t crd(uint32_t i, uint8_t k) { return (int16_t)(((i * 2654435761u) >> (k * 5)) % (W + 8)) - 4; }
+static inline int16_t len(uint32_t i, uint8_t k) { return (int16_t)(((i * 40503u) >> (k * 4)) % 16) + 1; }
+static inline uint16_t col(uint32_t i) { return colors[i & 7]; }
+
+static void tPixel(Adafruit_GFX &g, uint32_t i)     { g.drawPixel(crd(i, 0), crd(i, 1), col(i)); }
+static void tLine(Adafruit_GFX &g, uint32_t i)      { g.drawLine(crd(i, 0), crd(i, 1), crd(i, 2), crd(i, 3), col(i)); }
+static void tHLine(Adafruit_GFX &g, uint32_t i)     { g.drawFastHLine(crd(i, 0), crd(i, 1), len(i, 0) * 2, col(i)); }
+static void tVLine(Adafruit_GFX &g, uint32_t i)     { g.drawFastVLine(crd(i, 0), crd(i, 1), len(i, 0) * 2, col(i)); }
+static void tRect(Adafruit_GFX &g, uint32_t i)      { g.drawRect(crd(i, 0), crd(i, 1), len(i, 0), len(i, 1), col(i)); }
+static void tFillRect(Adafruit_GFX &g, uint32_t i)  { g.fillRect(crd(i, 0), crd(i, 1), len(i, 0), len(i, 1), col(i)); }
+static void tFillScreen(Adafruit_GFX &g, uint32_t i) { g.fillScreen(col(i)); }
+static void tCircle(Adafruit_GFX &g, uint32_t i)    { g.drawCircle(crd(i, 0), crd(i, 1), len(i, 0) / 2, col(i)); }
+static void tFillCircle(Adafruit_GFX &g, uint32_t i) { g.fillCircle(crd(i, 0), crd(i, 1), len(i, 0) / 2, col(i)); }
+static void tTriangle(Adafruit_GFX &g, uint32_t i) {
+	g.drawTriangle(crd(i, 0), crd(i, 1), crd(i, 2), crd(i, 3), crd(i, 4), crd(i, 5), col(i));
+}
+static void tFillTriangle(Adafruit_GFX &g, uint32_t i) {
+	g.fillTriangle(crd(i, 0), crd(i, 1), crd(i, 2), crd(i, 3), crd(i, 4), crd(i, 5), col(i));
+}
+static void tRoundRect(Adafruit_GFX &g, uint32_t i) {
+	g.drawRoundRect(crd(i, 0), crd(i, 1), len(i, 0) + 4, len(i, 1) + 4, 2, col(i));
+}
+static void tFillRoundRect(Adafruit_GFX &g, uint32_t i) {
+	g.fillRoundRect(crd(i, 0), crd(i, 1), len(i, 0) + 4, len(i, 1) + 4, 2, col(i));
+}
+static void tBitmap(Adafruit_GFX &g, uint32_t i)    { g.drawBitmap(crd(i, 0), crd(i, 1), bitmap, 16, 16, col(i)); }
+static void tBitmapBg(Adafruit_GFX &g, uint32_t i)  { g.drawBitmap(crd(i, 0), crd(i, 1), bitmap, 16, 16, col(i), 0); }
+static void tXBitmap(Adafruit_GFX &g, uint32_t i)   { g.drawXBitmap(crd(i, 0), crd(i, 1), bitmap, 16, 16, col(i)); }
+static void tChar(Adafruit_GFX &g, uint32_t i)      { g.drawChar(crd(i, 0), crd(i, 1), 'A' + (i % 26), col(i), 0, 1); }
+static void tChar2(Adafruit_GFX &g, uint32_t i)     { g.drawChar(crd(i, 0), crd(i, 1), 'A' + (i % 26), col(i), 0, 2); }
+static void tPrint(Adafruit_GFX &g, uint32_t i) {
+	g.setCursor(crd(i, 0), crd(i, 1));
+	g.setTextColor(col(i));
+	g.print("Hi!");
+}
+
+static const struct {
+	const char *name;
+	void      (*fn)(Adafruit_GFX &, uint32_t);
+} tests[] = {
+	{ "drawPixel",       tPixel         },
+	{ "drawLine",        tLine          },
+	{ "drawFastHLine",   tHLine         },
+	{ "drawFastVLine",   tVLine         },
+	{ "drawRect",        tRect          },
+	{ "fillRect",        tFillRect      },
+	{ "fillScreen",      tFillScreen    },
+	{ "drawCircle",      tCircle        },
+	{ "fillCircle",      tFillCircle    },
+	{ "drawTriangle",    tTriangle      },
+	{ "fillTriangle",    tFillTriangle  },
+	{ "drawRoundRect",   tRoundRect     },
+	{ "fillRoundRect",   tFillRoundRect },
+	{ "drawBitmap",      tBitmap        },
+	{ "drawBitmap (bg)", tBitmapBg      },
+	{ "drawXBitmap",     tXBitmap       },
+	{ "drawChar",        tChar          },
+	{ "drawChar (x2)",   tChar2         },
+	{ "print",           tPrint         } };
+
+static uint16_t frame565[W * H];
+static uint8_t  frame888[W * H * 3];
+
+static void upPixels(GoodStuenPanel &p) {
+	int16_t x, y;
+	for (y = 0; y < H; y++)
+		for (x = 0; x < W; x++) p.drawPixel(x, y, frame565[y * W + x]);
+}
+static void upBlit565(GoodStuenPanel &p) { p.blit(frame565, 0, 0, W, H); }
+static void upBlit888(GoodStuenPanel &p) { p.blit(frame888, 0, 0, W, H); }
+
+static const struct {
+	const char *name;
+	void      (*fn)(GoodStuenPanel &);
+} uploads[] = {
+	{ "drawPixel (565)", upPixels  },
+	{ "blit (565)",      upBlit565 },
+	{ "blit (888)",      upBlit888 } };
+
+// Frames per second uploaded by fn to p, over about 'seconds'.
+static double frameRate(GoodStuenPanel &p, void (*fn)(GoodStuenPanel &), double seconds) {
+	typedef std::chrono::steady_clock clock;
+	clock::time_point start = clock::now();
+	double   elapsed;
+	uint32_t frames = 0;
+
+	do {
+		fn(p);
+		frames++;
+		elapsed = std::chrono::duration<double>(clock::now() - start).count();
+	} while (elapsed < seconds);
+	return frames / elapsed;
+}
+
+// Calls per second of test fn on g, over about 'seconds'.
+static double rate(Adafruit_GFX &g, void (*fn)(Adafruit_GFX &, uint32_t), double seconds) {
+	typedef std::chrono::steady_clock clock;
+	clock::time_point start = clock::now();
+	double   elapsed;
+	uint64_t calls = 0;
+	uint32_t i;
+
+	do {
+		for (i = 0; i < CALLS; i++) fn(g, i);
+		calls  += CALLS;
+		elapsed = std::chrono::duration<double>(clock::now() - start).count();
+	} while (elapsed < seconds);
+	return calls / elapsed;
+}
+
+int main(int argc, char *argv[]) {
+	double  seconds = 0.2;
+	uint8_t planes  = 4, dither = 0, t, k;
+	int     opt, i;
+
+	while ((opt = getopt(argc, argv, "t:p:d:")) != -1) {
+		switch (opt) {
+		case 't': seconds = atof(optarg); break;
+		case 'p': planes  = atoi(optarg); break;
+		case 'd': dither  = atoi(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-t seconds] [-p planes] [-d ditherbits]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// Pins are only looked up in begin(), which isn't called: drawing
+	// into the buffer needs no hardware.
+	GoodStuenPanel      panel(2, 3, 4, 5, 6, 7, 10, 11, 12, 14, 8, 13, 9, false, planes);
+	GoodStuenPanel32x32 matrix(2, 3, 4, 5, 6, 7, 10, 11, 12, 14, 8, 13, 9, false);
+	FlatCanvas          flat;
+	Adafruit_GFX       *targets[] = { &panel, &matrix, &flat };
+
+	if (!panel.backBuffer() || !matrix.backBuffer()) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	if (dither && !panel.enableDither(dither)) {
+		fprintf(stderr, "Can't dither %d bits at %d planes\n", dither, planes);
+		return 1;
+	}
+
+	printf("%d planes%s, %.2f s per test\n\n", planes,
+		dither ? (dither > 1 ? ", 2-bit dither" : ", 1-bit dither") : "", seconds);
+	printf("%-16s %7s %23s %23s %23s\n", "", "px/call",
+		"GoodStuenPanel", "GoodStuenPanel32x32", "flat canvas");
+	printf("%-16s %7s", "", "");
+	for (k = 0; k < 3; k++) printf(" %12s %10s", "calls/s", "Mpx/s");
+	printf("\n");
+
+	for (t = 0; t < sizeof(tests) / sizeof(tests[0]); t++) {
+		CountCanvas count;
+		double      px;
+		uint32_t    i;
+
+		for (i = 0; i < CALLS; i++) tests[t].fn(count, i);
+		px = (double)count.n / CALLS;
+		printf("%-16s %7.1f", tests[t].name, px);
+		fflush(stdout);
+		for (k = 0; k < 3; k++) {
+			double r = rate(*targets[k], tests[t].fn, seconds);
+			printf(" %12.0f %10.2f", r, r * px / 1e6);
+			fflush(stdout);
+		}
+		printf("\n");
+	}
+
+	printf("\n%-24s %23s %23s\n", "32x32 frame upload", "GoodStuenPanel",
+		"GoodStuenPanel32x32");
+	printf("%-24s", "");
+	for (k = 0; k < 2; k++) printf(" %12s %10s", "frames/s", "Mpx/s");
+	printf("\n");
+	srand(1);
+	for (i = 0; i < W * H; i++) frame565[i] = rand();
+	for (i = 0; i < W * H * 3; i++) frame888[i] = rand();
+	for (t = 0; t < sizeof(uploads) / sizeof(uploads[0]); t++) {
+		printf("%-24s", uploads[t].name);
+		fflush(stdout);
+		for (k = 0; k < 2; k++) {
+			double r = frameRate(k ? (GoodStuenPanel &)matrix : panel, uploads[t].fn, seconds);
+			printf(" %12.0f %10.2f", r, r * W * H / 1e6);
+			fflush(stdout);
+		}
+		printf("\n");
+	}
+	return 0;
+}
@@ -0,0 +1,42 @@
+// Color conversion checks for the Linux host build.
+// NOT ARDUINO CODE -- see README.txt.
+//
+//   ./colortest
+//
+// Checks the linear (non-gamma) 8/8/8 and HSV conversions against
+// hand-packed 5/6/5 values.  Prints each mismatch; exits 1 if any.
+
+#include <stdio.h>
+#include "Arduino.h"
+#include "GoodStuenPanel.h"
+
+static int bad = 0;
+
+static void check(const char *what, uint16_t got, uint16_t want) {
+	if (got == want) return;
+	printf("%s: 0x%04X, want 0x%04X\n", what, got, want);
+	bad++;
+}
+
+int main(void) {
+	// Pins are only looked up in begin(), which isn't called
+	GoodStuenPanel panel(2, 3, 4, 5, 6, 7, 10, 11, 12, 14, 8, 13, 9, false);
+	uint16_t       r, g, b;
+
+	check("Color888(255,0,0)",         panel.Color888(255, 0, 0),        0xF800);
+	check("Color888(0,255,0)",         panel.Color888(0, 255, 0),        0x07E0);
+	check("Color888(0,0,255)",         panel.Color888(0, 0, 255),        0x001F);
+	check("Color888(255,255,255)",     panel.Color888(255, 255, 255),    0xFFFF);
+	check("Color888(255,0,0,false)",   panel.Color888(255, 0, 0, false), 0xF800);
+	check("ColorHSV(0,255,255,false)", panel.ColorHSV(0, 255, 255, false), 0xF800);
+	check("ColorHSV(512,255,255,false)", panel.ColorHSV(512, 255, 255, false), 0x07E0);
+	check("ColorHSV(1024,255,255,false)", panel.ColorHSV(1024, 255, 255, false), 0x001F);
+
+	// Every 8/8/8 step that survives 5/6/5, on its own channel
+	for (r = 0; r < 256; r += 8) check("Color888 red", panel.Color888(r, 0, 0), (r >> 3) << 11);
+	for (g = 0; g < 256; g += 4) check("Color888 green", panel.Color888(0, g, 0), (g >> 2) << 5);
+	for (b = 0; b < 256; b += 8) check("Color888 blue", panel.Color888(0, 0, b), b >> 3);
+
+	printf("%s\n", bad ? "FAILED" : "OK");
+	return bad ? 1 : 0;
+}
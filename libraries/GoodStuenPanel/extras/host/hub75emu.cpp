@@ -0,0 +1,716 @@
+// HUB75 panel emulator and Due core backend for the Linux host build.
+// NOT ARDUINO CODE -- see README.txt and hub75emu.h.
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+#include "Arduino.h"
+#include "GoodStuenHal.h"
+#include "hub75emu.h"
+
+#define EMU_MAXCHAINS 5
+#define EMU_NEVER     UINT64_MAX
+
+// -------------------- Peripherals --------------------
+
+static Pio            pios[4];
+static Tc             tc0;
+static Dmac           dmac;
+static DWT_Type       dwt;
+static CoreDebug_Type coredebug;
+
+Pio *const PIOA = &pios[0], *const PIOB = &pios[1],
+    *const PIOC = &pios[2], *const PIOD = &pios[3];
+Tc             *const TC0       = &tc0;
+Dmac           *const DMAC      = &dmac;
+DWT_Type       *const DWT       = &dwt;
+CoreDebug_Type *const CoreDebug = &coredebug;
+HostSerial Serial, SerialUSB;
+
+#define PA(n) { &pios[0], 1u << (n) }
+#define PB(n) { &pios[1], 1u << (n) }
+#define PC(n) { &pios[2], 1u << (n) }
+#define PD(n) { &pios[3], 1u << (n) }
+
+// Arduino Due pins 0-71 (variant.cpp); analog pins start at 54.
+const PinDescription g_APinDescription[] = {
+	PA(8),  PA(9),  PB(25), PC(28), PC(26), PC(25), PC(24), PC(23), // 0-7
+	PC(22), PC(21), PC(29), PD(7),  PD(8),  PB(27), PD(4),  PD(5),  // 8-15
+	PA(13), PA(12), PA(11), PA(10), PB(12), PB(13), PB(26), PA(14), // 16-23
+	PA(15), PD(0),  PD(1),  PD(2),  PD(3),  PD(6),  PD(9),  PA(7),  // 24-31
+	PD(10), PC(1),  PC(2),  PC(3),  PC(4),  PC(5),  PC(6),  PC(7),  // 32-39
+	PC(8),  PC(9),  PA(19), PA(20), PC(19), PC(18), PC(17), PC(16), // 40-47
+	PC(15), PC(14), PC(13), PC(12), PB(21), PB(14), PA(16), PA(24), // 48-55
+	PA(23), PA(22), PA(6),  PA(4),  PA(3),  PA(2),  PB(17), PB(18), // 56-63
+	PB(19), PB(20), PB(15), PB(16), PA(1),  PA(0),  PA(17), PA(18)  // 64-71
+};
+#define NUM_PINS (sizeof(g_APinDescription) / sizeof(g_APinDescription[0]))
+
+// -------------------- Clock and locking --------------------
+
+// emuLock guards all emulator state; the interrupt thread holds it for
+// the whole handler, so register accesses from there don't relock.
+// irqLock is PRIMASK: held by whichever thread has interrupts "off",
+// which keeps the interrupt thread from starting a handler.
+static std::mutex              emuLock, irqLock;
+static thread_local bool       emuHeld, primask;
+static std::atomic<bool>       quit(false);
+static std::thread             irqThread;
+static uint64_t                now; // Virtual CPU cycles
+static bool                    nvicOn;
+static std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+struct EmuGuard {
+	bool own;
+	EmuGuard() : own(!emuHeld) {
+		if (own) { emuLock.lock(); emuHeld = true; }
+	}
+	~EmuGuard() {
+		if (own) { emuHeld = false; emuLock.unlock(); }
+	}
+};
+
+static uint64_t wallCycles(void) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - t0).count() * (EMU_MCK / 1000000) / 1000;
+}
+
+// -------------------- Panel --------------------
+
+struct PanelPin {
+	uint8_t  port;
+	uint32_t mask;
+};
+
+static struct {
+	bool     attached;
+	uint8_t  chains, rows, naddr;
+	uint16_t cols, head;
+	PanelPin data[EMU_MAXCHAINS][6], clk, lat, oe, addr[4];
+	bool     clkHigh, latHigh, lit;
+	uint8_t  address, litAddress;
+	std::vector<uint8_t>  shiftreg, latched; // 6 bits per column per chain
+	std::vector<uint64_t> acc;               // Lit cycles, per LED
+	std::vector<uint64_t> rowtime;           // Lit cycles, per address
+	std::vector<uint64_t> lastAcc, lastRowtime; // Previous window
+	uint64_t lastT;
+} panel;
+
+static struct {
+	uint64_t start, isrCycles, pioWrites, tcAccesses;
+	uint32_t interrupts, frames, clocks, latches;
+} win;
+
+// Timer/counter channel 0 (the others aren't used):
+static struct {
+	uint32_t cmr, ra, rb, rc, sr, imr, cvStop;
+	bool     enabled, running, raDone, rcDone, tioa;
+	uint64_t start; // Virtual time at which CV was 0
+} tc;
+
+static bool tioaDrivesOE(void) {
+	// PB25 handed to peripheral B, and that's where OE is
+	return !(pios[1].PIO_PSR.value & PIO_PB25B_TIOA0) &&
+		(panel.oe.port == 1) && (panel.oe.mask == PIO_PB25B_TIOA0);
+}
+
+static bool level(const PanelPin &p) {
+	return pios[p.port].PIO_ODSR.value & p.mask;
+}
+
+// Add lit time up to t for the row pair on display.
+static void integrate(uint64_t t) {
+	uint8_t  k, i, bits, y;
+	uint16_t c;
+	uint64_t dt = t - panel.lastT;
+
+	panel.lastT = t;
+	if (!panel.lit || !dt) return;
+	panel.rowtime[panel.address % panel.rows] += dt;
+	for (k = 0; k < panel.chains; k++) {
+		for (c = 0; c < panel.cols; c++) {
+			bits = panel.latched[k * panel.cols + c];
+			for (i = 0; i < 6; i++) {
+				if (!(bits & (1 << i))) continue;
+				y = k * panel.rows * 2 + (panel.address % panel.rows) +
+					((i >= 3) ? panel.rows : 0);
+				panel.acc[(y * panel.cols + c) * 3 + (i % 3)] += dt;
+			}
+		}
+	}
+}
+
+// Pin levels (or TIOA) may have changed at time t.
+static void panelUpdate(uint64_t t) {
+	uint8_t  k, i, bits, address = 0;
+	uint16_t c;
+	bool     clk, lat, lit;
+
+	if (!panel.attached) return;
+	clk = level(panel.clk);
+	lat = level(panel.lat);
+	lit = !(tioaDrivesOE() ? tc.tioa : level(panel.oe));
+	for (i = 0; i < panel.naddr; i++) {
+		if (level(panel.addr[i])) address |= 1 << i;
+	}
+
+	if ((lit != panel.lit) || (address != panel.address) ||
+		(lat && !panel.latHigh)) {
+		integrate(t);
+		if (lit && !panel.lit) {
+			// Address lines are set one at a time, but never while lit
+			if (address < panel.litAddress) win.frames++; // Back to the top
+			panel.litAddress = address;
+		}
+		panel.lit     = lit;
+		panel.address = address;
+	}
+	if (clk && !panel.clkHigh) {
+		for (k = 0; k < panel.chains; k++) {
+			for (bits = 0, i = 0; i < 6; i++) {
+				if (level(panel.data[k][i])) bits |= 1 << i;
+			}
+			panel.shiftreg[k * panel.cols + panel.head] = bits;
+		}
+		if (++panel.head >= panel.cols) panel.head = 0;
+		win.clocks++;
+	}
+	if (lat && !panel.latHigh) {
+		for (k = 0; k < panel.chains; k++) {
+			for (c = 0; c < panel.cols; c++) {
+				panel.latched[k * panel.cols + c] =
+					panel.shiftreg[k * panel.cols + (panel.head + c) % panel.cols];
+			}
+		}
+		win.latches++;
+	}
+	panel.clkHigh = clk;
+	panel.latHigh = lat;
+}
+
+static PanelPin pinOf(uint8_t pin) {
+	PanelPin p = { 0, 0 };
+
+	if (pin < NUM_PINS) {
+		p.port = g_APinDescription[pin].pPort - pios;
+		p.mask = g_APinDescription[pin].ulPin;
+	}
+	return p;
+}
+
+void halAttachPanel(const uint8_t *datapins, uint8_t chains,
+	uint8_t a, uint8_t b, uint8_t c, uint8_t d,
+	uint8_t sclk, uint8_t latch, uint8_t oe, uint16_t cols, uint8_t rows) {
+	EmuGuard g;
+	uint8_t  k, i;
+
+	if (chains > EMU_MAXCHAINS) chains = EMU_MAXCHAINS;
+	for (k = 0; k < chains; k++) {
+		for (i = 0; i < 6; i++) panel.data[k][i] = pinOf(datapins[k * 6 + i]);
+	}
+	panel.clk     = pinOf(sclk);
+	panel.lat     = pinOf(latch);
+	panel.oe      = pinOf(oe);
+	panel.addr[0] = pinOf(a);
+	panel.addr[1] = pinOf(b);
+	panel.addr[2] = pinOf(c);
+	panel.addr[3] = pinOf(d);
+	panel.naddr   = (rows > 8) ? 4 : 3;
+	panel.chains  = chains;
+	panel.cols    = cols;
+	panel.rows    = rows;
+	panel.head    = 0;
+	panel.shiftreg.assign(chains * cols, 0);
+	panel.latched.assign(chains * cols, 0);
+	panel.acc.assign(chains * rows * 2 * cols * 3, 0);
+	panel.lastAcc.clear();
+	panel.lastRowtime.clear();
+	panel.rowtime.assign(rows, 0);
+	panel.lastT    = now;
+	panel.lit      = false;
+	panel.address  = 0;
+	panel.attached = true;
+	panelUpdate(now);
+}
+
+// -------------------- Timer --------------------
+
+static void setTioa(bool high, uint64_t t) {
+	if (high == tc.tioa) return;
+	tc.tioa = high;
+	if (tioaDrivesOE()) panelUpdate(t);
+}
+
+static void tioaAction(uint32_t action, uint64_t t) {
+	if (action == 1)      setTioa(true, t);
+	else if (action == 2) setTioa(false, t);
+	else if (action == 3) setTioa(!tc.tioa, t);
+}
+
+static uint32_t cvAt(uint64_t t) {
+	return tc.running ? (uint32_t)((t - tc.start) / 2) : tc.cvStop;
+}
+
+// Virtual time of the next compare match, or EMU_NEVER.
+static uint64_t nextMatch(bool *isRC) {
+	uint64_t ta = EMU_NEVER, tcm = EMU_NEVER;
+
+	if (!tc.running) return EMU_NEVER;
+	if (!tc.raDone) ta  = tc.start + (uint64_t)tc.ra * 2;
+	if (!tc.rcDone) tcm = tc.start + (uint64_t)tc.rc * 2;
+	*isRC = (tcm <= ta);
+	return *isRC ? tcm : ta;
+}
+
+// Process compare matches up to time t, in order.
+static void tcAdvance(uint64_t t) {
+	uint64_t te;
+	bool     rc;
+
+	while ((te = nextMatch(&rc)) <= t) {
+		if (!rc) {
+			tc.raDone = true;
+			tc.sr    |= TC_SR_CPAS;
+			tioaAction((tc.cmr & TC_CMR_ACPA_Msk) >> 16, te);
+			continue;
+		}
+		tc.rcDone = true;
+		tc.sr    |= TC_SR_CPCS;
+		tioaAction((tc.cmr & TC_CMR_ACPC_Msk) >> 18, te);
+		if (tc.cmr & TC_CMR_CPCSTOP) {
+			tc.running = false;
+			tc.cvStop  = tc.rc;
+		} else if ((tc.cmr & TC_CMR_WAVSEL_Msk) == TC_CMR_WAVSEL_UP_RC) {
+			tc.start  = te + 2; // Back to 0 on the tick after RC
+			tc.raDone = tc.rcDone = false;
+		}
+	}
+}
+
+static bool irqPending(void) {
+	return nvicOn && (tc.sr & tc.imr);
+}
+
+void emuTcWrite(TcChannel *ch, uint8_t reg, uint32_t v) {
+	EmuGuard g;
+
+	if (ch != &tc0.TC_CHANNEL[0]) {
+		ch->TC_CCR.value = v; // Not emulated
+		return;
+	}
+	tcAdvance(now);
+	now += EMU_IO_CYCLES;
+	win.tcAccesses++;
+	switch (reg) {
+	case TC_REG_CCR:
+		if (v & TC_CCR_CLKDIS) {
+			tc.cvStop  = cvAt(now);
+			tc.running = tc.enabled = false;
+		} else if (v & TC_CCR_CLKEN) {
+			tc.enabled = true;
+		}
+		if ((v & TC_CCR_SWTRG) && tc.enabled) {
+			tc.start   = now;
+			tc.running = true;
+			tc.raDone  = false;
+			tc.rcDone  = false;
+			tioaAction((tc.cmr & TC_CMR_ASWTRG_Msk) >> 22, now);
+		}
+		break;
+	case TC_REG_CMR: tc.cmr = v; break;
+	case TC_REG_RA:
+		tc.ra     = v;
+		tc.raDone = tc.running && (cvAt(now) >= v);
+		break;
+	case TC_REG_RB: tc.rb = v; break;
+	case TC_REG_RC:
+		tc.rc     = v;
+		tc.rcDone = tc.running && (cvAt(now) >= v);
+		break;
+	case TC_REG_IER: tc.imr |= v;  break;
+	case TC_REG_IDR: tc.imr &= ~v; break;
+	}
+}
+
+uint32_t emuTcRead(const TcChannel *ch, uint8_t reg) {
+	EmuGuard g;
+	uint32_t v = 0;
+
+	if (ch != &tc0.TC_CHANNEL[0]) return 0;
+	tcAdvance(now);
+	now += EMU_IO_CYCLES;
+	win.tcAccesses++;
+	switch (reg) {
+	case TC_REG_CV:  v = cvAt(now); break;
+	case TC_REG_CMR: v = tc.cmr; break;
+	case TC_REG_RA:  v = tc.ra; break;
+	case TC_REG_RB:  v = tc.rb; break;
+	case TC_REG_RC:  v = tc.rc; break;
+	case TC_REG_IMR: v = tc.imr; break;
+	case TC_REG_SR:
+		v     = tc.sr | (tc.running ? (1u << 16) : 0); // CLKSTA
+		tc.sr = 0; // Reading clears the status bits
+		break;
+	}
+	return v;
+}
+
+// -------------------- PIO --------------------
+
+void emuPioWrite(Pio *pio, uint8_t reg, uint32_t v) {
+	EmuGuard g;
+	uint32_t &odsr = pio->PIO_ODSR.value, &owsr = pio->PIO_OWSR.value,
+	         &psr  = pio->PIO_PSR.value,  &osr  = pio->PIO_OSR.value;
+
+	tcAdvance(now);
+	now += EMU_IO_CYCLES;
+	win.pioWrites++;
+	switch (reg) {
+	case PIO_REG_SODR: odsr |= v; break;
+	case PIO_REG_CODR: odsr &= ~v; break;
+	case PIO_REG_ODSR: odsr = (odsr & ~owsr) | (v & owsr); break;
+	case PIO_REG_OWER: owsr |= v; break;
+	case PIO_REG_OWDR: owsr &= ~v; break;
+	case PIO_REG_PER:  psr |= v; break;
+	case PIO_REG_PDR:  psr &= ~v; break;
+	case PIO_REG_OER:  osr |= v; break;
+	case PIO_REG_ODR:  osr &= ~v; break;
+	case PIO_REG_ABSR: pio->PIO_ABSR.value = v; break;
+	default: return;
+	}
+	panelUpdate(now);
+}
+
+uint32_t emuPioRead(const Pio *pio, uint8_t reg) {
+	EmuGuard g;
+
+	now += EMU_IO_CYCLES;
+	switch (reg) {
+	case PIO_REG_PDSR:
+	case PIO_REG_ODSR: return pio->PIO_ODSR.value;
+	case PIO_REG_PSR:  return pio->PIO_PSR.value;
+	case PIO_REG_OSR:  return pio->PIO_OSR.value;
+	case PIO_REG_OWSR: return pio->PIO_OWSR.value;
+	case PIO_REG_ABSR: return pio->PIO_ABSR.value;
+	}
+	return 0;
+}
+
+void PIO_Configure(Pio *pio, EPioType type, uint32_t mask, uint32_t) {
+	switch (type) {
+	case PIO_PERIPH_A:
+		pio->PIO_ABSR = pio->PIO_ABSR.value & ~mask;
+		pio->PIO_PDR  = mask;
+		break;
+	case PIO_PERIPH_B:
+		pio->PIO_ABSR = pio->PIO_ABSR.value | mask;
+		pio->PIO_PDR  = mask;
+		break;
+	case PIO_OUTPUT_0:
+	case PIO_OUTPUT_1:
+		if (type == PIO_OUTPUT_1) pio->PIO_SODR = mask;
+		else                      pio->PIO_CODR = mask;
+		pio->PIO_OER = mask;
+		pio->PIO_PER = mask;
+		break;
+	default:
+		pio->PIO_ODR = mask;
+		pio->PIO_PER = mask;
+		break;
+	}
+}
+
+// -------------------- Interrupts --------------------
+
+void __disable_irq(void) {
+	if (!primask) {
+		irqLock.lock();
+		primask = true;
+	}
+}
+
+void __enable_irq(void) {
+	if (primask) {
+		primask = false;
+		irqLock.unlock();
+	}
+}
+
+uint32_t __get_PRIMASK(void) {
+	return primask;
+}
+
+void __set_PRIMASK(uint32_t mask) {
+	if (mask) __disable_irq();
+	else      __enable_irq();
+}
+
+void __DMB(void) {
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void NVIC_EnableIRQ(IRQn_Type irq) {
+	EmuGuard g;
+	if (irq == TC0_IRQn) nvicOn = true;
+}
+
+void NVIC_DisableIRQ(IRQn_Type irq) {
+	EmuGuard g;
+	if (irq == TC0_IRQn) nvicOn = false;
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type) { } // Pending follows TC_SR & TC_IMR
+void NVIC_SetPriority(IRQn_Type, uint32_t) { }
+void pmc_set_writeprotect(uint32_t) { }
+void pmc_enable_periph_clk(uint32_t) { }
+
+uint32_t emuCycles(void) {
+	EmuGuard g;
+	return (uint32_t)now;
+}
+
+// Take the timer interrupt whenever it's due in virtual time, running
+// at most a millisecond ahead of the wall clock.
+static void irqLoop(void) {
+	bool     idle;
+	bool     rc;
+	uint64_t te, t;
+
+	while (!quit) {
+		irqLock.lock();
+		{
+			EmuGuard g;
+
+			tcAdvance(now);
+			idle = false;
+			if (!irqPending()) {
+				te = nextMatch(&rc);
+				t  = wallCycles();
+				if (!tc.running) {
+					// Nothing scheduled: let virtual time follow the wall
+					if (t > now) now = t;
+					idle = true;
+				} else if (!nvicOn || (te > (t + EMU_MCK / 1000))) {
+					idle = true;
+				} else {
+					if (te > now) now = te;
+					tcAdvance(now);
+				}
+			}
+			if (!idle && irqPending()) {
+				now += EMU_IRQ_CYCLES;
+				t = now;
+				primask = true;
+				TC0_Handler();
+				primask = false;
+				win.isrCycles += now - t;
+				win.interrupts++;
+			}
+		}
+		irqLock.unlock();
+		if (idle) std::this_thread::sleep_for(std::chrono::microseconds(500));
+	}
+}
+
+void emuStart(void) {
+	for (int i = 0; i < 4; i++) pios[i].PIO_PSR.value = 0xFFFFFFFF;
+	win.start = now;
+	irqThread = std::thread(irqLoop);
+}
+
+void emuStop(void) {
+	quit = true;
+	if (irqThread.joinable()) irqThread.join();
+}
+
+// -------------------- Results --------------------
+
+static size_t imageBytes(void) {
+	EmuGuard g;
+	return panel.chains * panel.rows * 2 * panel.cols * 3;
+}
+
+bool hub75Image(uint8_t *rgb, uint16_t *width, uint16_t *height) {
+	EmuGuard g;
+	uint32_t i, n;
+	uint64_t rt;
+	uint16_t y;
+
+	if (!panel.attached) return false;
+	integrate(now);
+	// A window too short to hold a whole frame would be partly dark;
+	// show the previous one instead.
+	bool prev = !win.frames && !panel.lastAcc.empty();
+	const std::vector<uint64_t> &acc = prev ? panel.lastAcc : panel.acc,
+	  &rowtime = prev ? panel.lastRowtime : panel.rowtime;
+	*width  = panel.cols;
+	*height = panel.chains * panel.rows * 2;
+	for (y = 0; y < *height; y++) {
+		rt = rowtime[y % panel.rows];
+		n  = panel.cols * 3;
+		for (i = 0; i < n; i++) {
+			uint64_t a = acc[y * n + i];
+			rgb[y * n + i] = rt ? (uint8_t)((a * 255 + rt / 2) / rt) : 0;
+		}
+	}
+	return true;
+}
+
+void hub75Stats(Hub75Stats *s, bool reset) {
+	EmuGuard g;
+	uint64_t lit = 0;
+	uint8_t  r;
+
+	integrate(now);
+	for (r = 0; r < panel.rowtime.size(); r++) lit += panel.rowtime[r];
+	s->cycles      = now - win.start;
+	s->isrCycles   = win.isrCycles;
+	s->interrupts  = win.interrupts;
+	s->frames      = win.frames;
+	s->pioWrites   = win.pioWrites;
+	s->tcAccesses  = win.tcAccesses;
+	s->clocks      = win.clocks;
+	s->latches     = win.latches;
+	s->refreshHz   = s->cycles ? (float)win.frames * EMU_MCK / s->cycles : 0;
+	s->opsPerFrame = win.frames ? (float)win.pioWrites / win.frames : 0;
+	s->cpuLoad     = s->cycles ? 100.0f * win.isrCycles / s->cycles : 0;
+	s->oeDuty      = s->cycles ? 100.0f * lit / s->cycles : 0;
+	if (reset) {
+		if (win.frames) {
+			panel.lastAcc     = panel.acc;
+			panel.lastRowtime = panel.rowtime;
+		}
+		memset(&win, 0, sizeof(win));
+		win.start = now;
+		std::fill(panel.acc.begin(), panel.acc.end(), 0);
+		std::fill(panel.rowtime.begin(), panel.rowtime.end(), 0);
+	}
+}
+
+void hub75Render(FILE *out) {
+	std::vector<uint8_t> img(imageBytes());
+	uint16_t w, h, x, y;
+	uint8_t *a, *b;
+
+	if (!hub75Image(img.data(), &w, &h)) return;
+	for (y = 0; y < h; y += 2) {
+		for (x = 0; x < w; x++) {
+			a = &img[(y * w + x) * 3];
+			b = &img[((y + 1) * w + x) * 3];
+			fprintf(out, "\x1b[38;2;%d;%d;%dm\x1b[48;2;%d;%d;%dm\xe2\x96\x80",
+				a[0], a[1], a[2], b[0], b[1], b[2]);
+		}
+		fprintf(out, "\x1b[0m\n");
+	}
+	fflush(out);
+}
+
+bool hub75WritePPM(const char *path) {
+	std::vector<uint8_t> img(imageBytes());
+	uint16_t w, h;
+	FILE    *f;
+
+	if (!hub75Image(img.data(), &w, &h)) return false;
+	if (!(f = fopen(path, "wb"))) return false;
+	fprintf(f, "P6\n%d %d\n255\n", w, h);
+	fwrite(img.data(), 3, w * h, f);
+	return fclose(f) == 0;
+}
+
+// -------------------- Arduino API --------------------
+
+void pinMode(uint32_t pin, uint32_t mode) {
+	if (pin >= NUM_PINS) return;
+	if (mode == OUTPUT) g_APinDescription[pin].pPort->PIO_OER = g_APinDescription[pin].ulPin;
+	else                g_APinDescription[pin].pPort->PIO_ODR = g_APinDescription[pin].ulPin;
+}
+
+void digitalWrite(uint32_t pin, uint32_t val) {
+	if (pin >= NUM_PINS) return;
+	if (val) g_APinDescription[pin].pPort->PIO_SODR = g_APinDescription[pin].ulPin;
+	else     g_APinDescription[pin].pPort->PIO_CODR = g_APinDescription[pin].ulPin;
+}
+
+int digitalRead(uint32_t pin) {
+	if (pin >= NUM_PINS) return LOW;
+	return (g_APinDescription[pin].pPort->PIO_PDSR & g_APinDescription[pin].ulPin) ? HIGH : LOW;
+}
+
+void delay(uint32_t ms) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+	std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+uint32_t millis(void) {
+	return wallCycles() / (EMU_MCK / 1000);
+}
+
+uint32_t micros(void) {
+	return wallCycles() / (EMU_MCK / 1000000);
+}
+
+long random(long howbig) {
+	return howbig ? (rand() % howbig) : 0;
+}
+
+long random(long howsmall, long howbig) {
+	return (howsmall < howbig) ? (howsmall + random(howbig - howsmall)) : howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+	srand(seed);
+}
+
+// -------------------- Serial --------------------
+
+static int lookahead = -1;
+
+size_t HostSerial::write(uint8_t c) {
+	return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+void HostSerial::flush(void) {
+	fflush(stdout);
+}
+
+int HostSerial::available(void) {
+	struct pollfd p = { 0, POLLIN, 0 };
+	if (lookahead >= 0) return 1;
+	return (poll(&p, 1, 0) > 0) && (p.revents & POLLIN) ? 1 : 0;
+}
+
+int HostSerial::read(void) {
+	uint8_t c;
+	int     r = lookahead;
+
+	if (r >= 0) {
+		lookahead = -1;
+		return r;
+	}
+	if (!available()) return -1;
+	return (::read(0, &c, 1) == 1) ? c : -1;
+}
+
+int HostSerial::peek(void) {
+	if (lookahead < 0) lookahead = read();
+	return lookahead;
+}
+
+size_t Stream::readBytes(uint8_t *buf, size_t n) {
+	size_t   i = 0;
+	uint32_t start = millis();
+	int      c;
+
+	while ((i < n) && ((millis() - start) < timeout)) {
+		if ((c = read()) >= 0) buf[i++] = c;
+		else                   delay(1);
+	}
+	return i;
+}
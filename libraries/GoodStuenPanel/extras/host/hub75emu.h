@@ -0,0 +1,64 @@
+// HUB75 panel emulator for the Linux host build.
+// NOT ARDUINO CODE -- see README.txt.
+//
+// Watches the pins GoodStuenPanel drives through the emulated PIO
+// controllers, as a panel would: data shifts in on each CLK rising edge,
+// LAT copies the shift registers to the LED drivers, and while OE is low
+// the addressed row pair lights up.  How long each LED is lit over a
+// sampling window is integrated to give the decoded image.
+//
+// Time is virtual, counted in 84 MHz CPU cycles.  Each peripheral
+// register access costs EMU_IO_CYCLES and entering the interrupt
+// EMU_IRQ_CYCLES; the TC0 counter and its compare matches follow that
+// clock, and the interrupt thread keeps it in step with wall time.
+// Only I/O is counted, not the instructions between accesses, so cycle
+// figures (and the refresh rate, which calibrate() derives from them)
+// are an optimistic bound rather than a Due measurement.  They are
+// exact, though, for counting operations and comparing driver changes.
+
+#ifndef _HUB75EMU_H_
+#define _HUB75EMU_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define EMU_MCK        84000000UL
+#define EMU_IO_CYCLES  2  // Per PIO/TC register load or store
+#define EMU_IRQ_CYCLES 12 // Exception entry to first handler instruction
+
+struct Hub75Stats {
+	uint64_t cycles;       // Virtual CPU cycles in the window
+	uint64_t isrCycles;    // of which in TC0_Handler()
+	uint32_t interrupts;   // TC0 interrupts taken
+	uint32_t frames;       // Complete refreshes (row address wrapped)
+	uint64_t pioWrites;    // PIO register stores, all contexts
+	uint64_t tcAccesses;   // TC register loads and stores
+	uint32_t clocks;       // CLK rising edges
+	uint32_t latches;      // LAT rising edges
+	float    refreshHz;    // frames per virtual second
+	float    opsPerFrame;  // PIO stores per refresh
+	float    cpuLoad;      // Percent of cycles in the interrupt
+	float    oeDuty;       // Percent of time any row was lit
+};
+
+// Decoded image of the last window: 8-bit R,G,B per pixel, row by row,
+// in chain coordinates (parallel chains stacked).  Each LED's lit time
+// is scaled against its row's total lit time, so full on is 255
+// regardless of brightness settings (see oeDuty for that).  Returns
+// false until a panel is attached.
+bool hub75Image(uint8_t *rgb, uint16_t *width, uint16_t *height);
+
+// Stats for the window since the last reset, and start a new window
+// (image integration too).
+void hub75Stats(Hub75Stats *stats, bool reset);
+
+// Draw the image on an ANSI 24-bit color terminal, two pixel rows per
+// character line; or write it as a binary PPM file.
+void hub75Render(FILE *out);
+bool hub75WritePPM(const char *path);
+
+// Start and stop the interrupt thread (main.cpp does this).
+void emuStart(void);
+void emuStop(void);
+
+#endif // _HUB75EMU_H_
@@ -0,0 +1,64 @@
+// Runs an Arduino sketch against the HUB75 emulator on Linux.
+// NOT ARDUINO CODE -- see README.txt.
+//
+//   ./sketch [-t seconds] [-i interval] [-p image.ppm] [-q]
+//
+// Calls setup(), then loop() until the run time (default 10 s) is up.
+// Every 'interval' seconds (default 1), between calls to loop(), prints
+// the emulator's refresh statistics and draws the panel on the terminal
+// (-q: statistics only).  -p saves the final image as a PPM file.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Arduino.h"
+#include "hub75emu.h"
+
+static void report(bool draw) {
+	Hub75Stats s;
+
+	hub75Stats(&s, false);
+	fprintf(stderr,
+		"[emu] %.0f Hz refresh, %.1f%% CPU, %u interrupts, %.0f PIO writes/frame, "
+		"OE duty %.1f%%\n", s.refreshHz, s.cpuLoad, s.interrupts,
+		s.opsPerFrame, s.oeDuty);
+	if (draw) hub75Render(stderr);
+	hub75Stats(&s, true);
+}
+
+int main(int argc, char *argv[]) {
+	double      runtime = 10.0, interval = 1.0;
+	const char *ppm     = NULL;
+	bool        draw    = true;
+	uint32_t    start, last;
+	int         opt;
+
+	while ((opt = getopt(argc, argv, "t:i:p:q")) != -1) {
+		switch (opt) {
+		case 't': runtime  = atof(optarg); break;
+		case 'i': interval = atof(optarg); break;
+		case 'p': ppm      = optarg;       break;
+		case 'q': draw     = false;        break;
+		default:
+			fprintf(stderr, "usage: %s [-t seconds] [-i interval] "
+				"[-p image.ppm] [-q]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	emuStart();
+	setup();
+	start = last = millis();
+	while ((millis() - start) < (uint32_t)(runtime * 1000)) {
+		loop();
+		Serial.flush();
+		if ((millis() - last) >= (uint32_t)(interval * 1000)) {
+			last = millis();
+			report(draw);
+		}
+	}
+	if (ppm && !hub75WritePPM(ppm)) fprintf(stderr, "[emu] can't write %s\n", ppm);
+	emuStop();
+	return 0;
+}
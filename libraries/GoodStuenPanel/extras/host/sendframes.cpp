@@ -0,0 +1,348 @@
+// Frame stream sender for GoodStuenPanel::receiveFrames(), and a
+// loopback test of the receiver.  NOT ARDUINO CODE -- see README.txt.
+//
+//   ./sendframes [-s 16|32] [-x tiles] [-p planes] [-d ditherbits]
+//                [-i frames.rgb565 | -u] [-z [-k keyframes]] [-n frames]
+//                [-f fps] [-o device] [-l [-b buffers]]
+//
+// Renders each frame into a GoodStuenPanel of the given geometry (panel
+// height -s, default 32; -x panels in a row; -p and -d as the receiving
+// sketch has them) and sends its packed buffer as a STREAM_RAW frame.
+// Frames are either read from a file of raw 5/6/5 pixels (-i, little
+// endian, row by row, looped) or an animated test pattern: a plasma,
+// or with -u, a mostly static one like UI content.  -z sends each
+// frame as a STREAM_DELTA against the one before where that's smaller,
+// with a raw keyframe every -k frames (default: only the first).  -n
+// stops after that many frames (default: never), -f limits the frame
+// rate.  Output goes to stdout, or to -o, e.g. the Due's native USB
+// port:
+//
+//   ./sendframes -u -z -o /dev/ttyACM0
+//
+// -l sends the frames (default 200) to a receiving panel in the same
+// process instead, on the emulator, through a stream that hands out
+// data in USB-sized packets of random length and throws in stray
+// bytes, frames of the wrong size and truncated deltas.  Every frame
+// presented is checked against the one sent once it reaches the
+// display.  -b sets that panel's buffers: 1 (single), 2 (double, the
+// default) or 3 (queue).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "Arduino.h"
+#include "GoodStuenPanel.h"
+#include "hub75emu.h"
+
+// A row of 'tiles' panels with 'rows' scan rows, on the same pins as
+// the sketches, with access to the frame on display.
+class Panel : public GoodStuenPanel {
+public:
+	Panel(uint8_t rows, uint8_t tiles, boolean dbuf, uint8_t planes) :
+		GoodStuenPanel(32 * tiles, rows, 2, 3, 4, 5, 6, 7, 10, 11, 12, 14,
+			8, 13, 9, dbuf, planes) { }
+	const uint8_t *front(void) { return matrixbuff[frontindex]; }
+};
+
+// Loopback stream: data written is read back in packets of 1 to 64
+// bytes, one at a time, as USB delivers it.
+class LoopStream : public Stream {
+public:
+	LoopStream() : head(0), ready(0) { }
+	size_t write(uint8_t c) {
+		q.push_back(c);
+		return 1;
+	}
+	using Print::write;
+	int available(void) {
+		if ((ready == head) && (ready < q.size())) {
+			ready += 1 + rand() % 64;
+			if (ready > q.size()) ready = q.size();
+		}
+		return ready - head;
+	}
+	int read(void) { return available() ? q[head++] : -1; }
+	int peek(void) { return available() ? q[head] : -1; }
+	void compact(void) { // Drop what's been read
+		q.erase(q.begin(), q.begin() + head);
+		ready -= head;
+		head   = 0;
+	}
+private:
+	std::vector<uint8_t> q;
+	size_t               head, ready;
+};
+
+// Frame header (see STREAM_RAW in GoodStuenPanel.h).
+static void header(uint8_t *h, uint8_t type, uint32_t len) {
+	h[0] = 'G';
+	h[1] = 'S';
+	h[2] = type;
+	h[3] = len;
+	h[4] = len >> 8;
+	h[5] = len >> 16;
+	h[6] = len >> 24;
+}
+
+// Delta payload turning 'prev' into 'cur' (see STREAM_DELTA): the mask
+// of scan rows that differ, then each of those rows' runs.
+static void encodeDelta(std::vector<uint8_t> &out, const uint8_t *cur,
+	const uint8_t *prev, uint32_t size, uint8_t rows, uint32_t rowbytes) {
+	uint32_t span = size / rows, mask = 0, i, j, k, r;
+	std::vector<uint8_t> a(span), b(span);
+
+	out.assign(4, 0);
+	for (r = 0; r < rows; r++) {
+		// Row r's bytes in every chain and phase, one after another
+		for (i = 0; i < span; i += rowbytes) {
+			k = (i / rowbytes) * rows * rowbytes + r * rowbytes;
+			memcpy(&a[i], &cur[k], rowbytes);
+			memcpy(&b[i], &prev[k], rowbytes);
+		}
+		if (a == b) continue;
+		mask |= 1UL << r;
+		for (i = 0; i < span; i = j) {
+			if (a[i] == b[i]) { // Unchanged
+				for (j = i + 1; (j < span) && (j - i < 128) && (a[j] == b[j]); j++);
+				out.push_back(j - i - 1);
+				continue;
+			}
+			for (j = i + 1; (j < span) && (j - i < 64) && (a[j] == a[i]); j++);
+			if (j - i >= 3) { // Repeated
+				out.push_back(0xC0 | (j - i - 1));
+				out.push_back(a[i]);
+				continue;
+			}
+			// Literal, up to two unchanged bytes or three repeated ones
+			for (j = i + 1; (j < span) && (j - i < 64); j++) {
+				if ((j + 1 < span) && (a[j] == b[j]) && (a[j + 1] == b[j + 1])) break;
+				if ((j + 2 < span) && (a[j] == a[j + 1]) && (a[j] == a[j + 2])) break;
+			}
+			out.push_back(0x80 | (j - i - 1));
+			out.insert(out.end(), &a[i], &a[j]);
+		}
+	}
+	for (i = 0; i < 4; i++) out[i] = mask >> (i * 8);
+}
+
+// Test pattern frame n: a plasma with a bar moving down over it, or
+// (ui) a fixed backdrop with a square bouncing around and a progress
+// bar creeping along.
+static void pattern(uint16_t *px, int16_t w, int16_t h, uint32_t n, bool ui) {
+	int16_t x, y, bx, by;
+	float   t = n * 0.05f, v;
+
+	if (ui) {
+		bx = n % (2 * (w - 6));
+		by = (n / 3) % (2 * (h - 14));
+		if (bx >= (w - 6)) bx = 2 * (w - 6) - bx - 1;
+		if (by >= (h - 14)) by = 2 * (h - 14) - by - 1;
+		for (y = 0; y < h; y++) {
+			for (x = 0; x < w; x++) {
+				px[y * w + x] = (!x || !y || (x == w - 1) || (y == h - 1)) ?
+					0x001f : ((y / 4) << 11) | ((x / 2) << 5);
+				if ((x >= bx) && (x < bx + 6) && (y >= by + 2) && (y < by + 8))
+					px[y * w + x] = 0xffe0;
+				if ((y >= h - 4) && (y < h - 2) && (x >= 2) &&
+					(x < 2 + (int16_t)((n / 4) % (w - 4))))
+					px[y * w + x] = 0x07e0;
+			}
+		}
+		return;
+	}
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			v = sinf(x * 0.2f + t) + sinf((x + y) * 0.15f - t * 1.3f) +
+				sinf(hypotf(x - w / 2, y - h / 2) * 0.3f + t);
+			px[y * w + x] =
+				((uint16_t)(15.5f + 15.5f * sinf(v * 2.0f)) << 11) |
+				((uint16_t)(31.5f + 31.5f * sinf(v * 2.0f + 2.1f)) << 5) |
+				(uint16_t)(15.5f + 15.5f * sinf(v * 2.0f + 4.2f));
+		}
+	}
+	for (x = 0; x < w; x++) px[(n % h) * w + x] = 0xffff;
+}
+
+// Raw mode, so a serial port passes every byte through untouched.
+static void rawPort(int fd) {
+	struct termios t;
+
+	if (tcgetattr(fd, &t)) return; // Not a terminal
+	cfmakeraw(&t);
+	tcsetattr(fd, TCSANOW, &t);
+}
+
+static bool writeAll(int fd, const uint8_t *buf, size_t n) {
+	ssize_t r;
+
+	while (n) {
+		if ((r = write(fd, buf, n)) <= 0) return false;
+		buf += r;
+		n   -= r;
+	}
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	uint8_t     rows = 16, tiles = 1, planes = 4, dither = 0, buffers = 2;
+	uint8_t     hdr[7], type;
+	uint32_t    frames = 0, keyint = 0, n, size, bad = 0, sent = 0, skipped = 0;
+	uint64_t    bytes = 0;
+	double      fps = 0;
+	const char *input = NULL, *output = NULL;
+	bool        loop = false, ui = false, delta = false, key;
+	FILE       *in = NULL;
+	int         opt, fd = 1;
+
+	while ((opt = getopt(argc, argv, "s:x:p:d:i:uzk:n:f:o:lb:")) != -1) {
+		switch (opt) {
+		case 's': rows    = atoi(optarg) / 2; break;
+		case 'x': tiles   = atoi(optarg);     break;
+		case 'p': planes  = atoi(optarg);     break;
+		case 'd': dither  = atoi(optarg);     break;
+		case 'i': input   = optarg;           break;
+		case 'u': ui      = true;             break;
+		case 'z': delta   = true;             break;
+		case 'k': keyint  = atoi(optarg);     break;
+		case 'n': frames  = atoi(optarg);     break;
+		case 'f': fps     = atof(optarg);     break;
+		case 'o': output  = optarg;           break;
+		case 'l': loop    = true;             break;
+		case 'b': buffers = atoi(optarg);     break;
+		default:
+			fprintf(stderr, "usage: %s [-s 16|32] [-x tiles] [-p planes] "
+				"[-d ditherbits] [-i frames.rgb565 | -u] [-z [-k keyframes]] "
+				"[-n frames] [-f fps] [-o device] [-l [-b buffers]]\n", argv[0]);
+			return 1;
+		}
+	}
+	if ((rows != 8) && (rows != 16)) rows = 16;
+	if (!tiles) tiles = 1;
+	if (loop && !frames) frames = 200;
+
+	// Encoder: never begun, only drawn into
+	Panel    panel(rows, tiles, false, planes);
+	int16_t  w = panel.width(), h = panel.height();
+	std::vector<uint16_t> px(w * h);
+	std::vector<uint8_t>  prev, payload, junk;
+
+	if (!panel.backBuffer() || (dither && !panel.enableDither(dither))) {
+		fprintf(stderr, "Can't set up the panel\n");
+		return 1;
+	}
+	size = panel.bufferSize();
+	if (input && !(in = fopen(input, "rb"))) {
+		perror(input);
+		return 1;
+	}
+	if (output) {
+		if ((fd = open(output, O_WRONLY | O_NOCTTY)) < 0) {
+			perror(output);
+			return 1;
+		}
+		rawPort(fd);
+	}
+	fprintf(stderr, "%dx%d, %d planes, %d dither bits: %u byte frames\n",
+		w, h, planes, dither, size);
+
+	Panel     *rx = NULL;
+	LoopStream stream;
+	if (loop) {
+		rx = new Panel(rows, tiles, buffers > 1, planes);
+		if ((buffers > 2) && !rx->enableQueue(buffers, FRAME_FIFO)) return 1;
+		if (dither && !rx->enableDither(dither)) return 1;
+		emuStart();
+		rx->begin();
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (n = 0; !frames || (n < frames); n++) {
+		if (!in) {
+			pattern(px.data(), w, h, n, ui);
+		} else if (fread(px.data(), 2, w * h, in) != (size_t)(w * h)) {
+			rewind(in); // Loop the file
+			if (fread(px.data(), 2, w * h, in) != (size_t)(w * h)) {
+				fprintf(stderr, "%s: less than one frame\n", input);
+				return 1;
+			}
+		}
+		panel.blit(px.data(), 0, 0, w, h);
+
+		// Loopback: now and then some line noise, a frame for another
+		// panel, or a delta cut short (after which the receiver needs a
+		// keyframe)
+		junk.clear();
+		if (loop && !(n % 7)) junk.insert(junk.end(), "xGGx", "xGGx" + 1 + rand() % 4);
+		if (loop && !(n % 13)) {
+			header(hdr, STREAM_RAW, size / 2);
+			junk.insert(junk.end(), hdr, hdr + 7);
+			junk.insert(junk.end(), panel.backBuffer(), panel.backBuffer() + size / 2);
+			skipped++;
+		}
+		key = !delta || !n || (keyint && !(n % keyint));
+		if (loop && !key && ((n % 11) == 5)) {
+			encodeDelta(payload, panel.backBuffer(), prev.data(), size, rows,
+				32 * tiles * (planes - 1));
+			header(hdr, STREAM_DELTA, payload.size() / 2);
+			junk.insert(junk.end(), hdr, hdr + 7);
+			junk.insert(junk.end(), payload.begin(), payload.begin() + payload.size() / 2);
+			skipped++;
+			key = true;
+		}
+
+		type = STREAM_RAW;
+		payload.assign(panel.backBuffer(), panel.backBuffer() + size);
+		if (!key) {
+			std::vector<uint8_t> d;
+			encodeDelta(d, panel.backBuffer(), prev.data(), size, rows,
+				32 * tiles * (planes - 1));
+			if (d.size() < size) {
+				type = STREAM_DELTA;
+				payload = d;
+			}
+		}
+		prev.assign(panel.backBuffer(), panel.backBuffer() + size);
+		header(hdr, type, payload.size());
+		bytes += junk.size() + 7 + payload.size();
+
+		if (!loop) {
+			if (!writeAll(fd, hdr, 7) || !writeAll(fd, payload.data(), payload.size())) {
+				perror("write");
+				return 1;
+			}
+		} else {
+			stream.write(junk.data(), junk.size());
+			stream.write(hdr, 7);
+			stream.write(payload.data(), payload.size());
+			while (!rx->receiveFrames(stream)) delay(1);
+			while (rx->swapPending()) delay(1); // On display once this clears
+			if (memcmp(rx->front(), panel.backBuffer(), size)) bad++;
+			stream.compact();
+		}
+		sent++;
+		if (fps > 0) {
+			std::this_thread::sleep_until(start +
+				std::chrono::duration<double>(sent / fps));
+		}
+	}
+	fprintf(stderr, "%u frames, %.0f bytes per frame on average\n",
+		sent, sent ? (double)bytes / sent : 0.0);
+
+	if (loop) {
+		GoodStuenStreamStats s;
+		rx->getStreamStats(&s);
+		emuStop();
+		printf("%u frames, %u presented, %u differ; %u skipped (%u sent)\n",
+			sent, s.frames, bad, s.errors, skipped);
+		printf("%u frames/s, %u bytes/s\n", s.fps, s.bps);
+		return (bad || (s.frames != sent) || (s.errors != skipped)) ? 1 : 0;
+	}
+	return 0;
+}
@@ -3,39 +3,95 @@
 
 #include <Arduino.h>
 
-static const uint8_t PROGMEM gammaVals[] = {
-  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-  0x00,0x00,0x01,0x01,0x01,0x01,0x01,0x01,
-  0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
-  0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
-  0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
-  0x01,0x01,0x01,0x01,0x01,0x01,0x02,0x02,
-  0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,
-  0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,
-  0x02,0x02,0x02,0x02,0x02,0x03,0x03,0x03,
-  0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,
-  0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x04,
-  0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,
-  0x04,0x04,0x04,0x04,0x04,0x04,0x05,0x05,
-  0x05,0x05,0x05,0x05,0x05,0x05,0x05,0x05,
-  0x05,0x05,0x05,0x06,0x06,0x06,0x06,0x06,
-  0x06,0x06,0x06,0x06,0x06,0x06,0x06,0x07,
-  0x07,0x07,0x07,0x07,0x07,0x07,0x07,0x07,
-  0x07,0x07,0x08,0x08,0x08,0x08,0x08,0x08,
-  0x08,0x08,0x08,0x08,0x09,0x09,0x09,0x09,
-  0x09,0x09,0x09,0x09,0x09,0x0a,0x0a,0x0a,
-  0x0a,0x0a,0x0a,0x0a,0x0a,0x0a,0x0b,0x0b,
-  0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0c,0x0c,
-  0x0c,0x0c,0x0c,0x0c,0x0c,0x0c,0x0d,0x0d,
-  0x0d,0x0d,0x0d,0x0d,0x0d,0x0e,0x0e,0x0e,
-  0x0e,0x0e,0x0e,0x0e,0x0f,0x0f,0x0f,0x0f
+// Gamma correction tables for Color888() and ColorHSV(), generated by the
+// compiler.  Red, green and blue LEDs in these panels don't track each
+// other, so each gets its own exponent, in hundredths (250 = 2.5).  Edit
+// here or pass -D to change them.
+#ifndef GAMMA_RED
+#define GAMMA_RED   250
+#endif
+#ifndef GAMMA_GREEN
+#define GAMMA_GREEN 250
+#endif
+#ifndef GAMMA_BLUE
+#define GAMMA_BLUE  250
+#endif
+
+// constexpr in C++11 allows a single return statement only, hence the
+// recursion.  Natural log: halve the range until x >= 0.5, then the
+// atanh series 2 * (z + z^3/3 + z^5/5 ...) with z = (x-1)/(x+1).
+constexpr double gammaLnSum(double z2, double zn, uint8_t n) {
+	return (n > 41) ? 0.0 : zn / n + gammaLnSum(z2, zn * z2, n + 2);
+}
+
+constexpr double gammaLnZ(double z) {
+	return 2.0 * gammaLnSum(z * z, z, 1);
+}
+
+constexpr double gammaLn(double x) {
+	return (x < 0.5) ? gammaLn(x * 2.0) - 0.69314718055994531 :
+		gammaLnZ((x - 1.0) / (x + 1.0));
+}
+
+// e^y for y <= 0: square e^(y/2) until y >= -0.5, then Taylor series.
+constexpr double gammaExpSum(double y, double term, uint8_t n) {
+	return (n > 20) ? term : term + gammaExpSum(y, term * y / n, n + 1);
+}
+
+constexpr double gammaSquare(double v) {
+	return v * v;
+}
+
+constexpr double gammaExp(double y) {
+	return (y < -0.5) ? gammaSquare(gammaExp(y * 0.5)) :
+		gammaExpSum(y, 1.0, 1);
+}
+
+// 8-bit input -> gamma -> nearest of the 2^depth output levels:
+constexpr uint8_t gammaLevel(uint8_t i, uint16_t gamma, uint8_t depth) {
+	return i ? (uint8_t)(gammaExp(gammaLn(i / 255.0) * gamma / 100.0) *
+		((1 << depth) - 1) + 0.5) : 0;
+}
+
+// depth-bit level -> 5- or 6-bit color field, repeating its top bits so
+// that drawPixel() gets the same level back when it keeps depth bits:
+constexpr uint8_t gammaField(uint8_t v, uint8_t depth, uint8_t field) {
+	return (v << (field - depth)) | (v >> (2 * depth - field));
+}
+
+// 0 to 255 as a template parameter pack, to initialize the tables:
+template <uint8_t... I> struct GammaIndex { };
+template <uint16_t N, uint8_t... I>
+struct GammaIndexGen : GammaIndexGen<N - 1, N - 1, I...> { };
+template <uint8_t... I>
+struct GammaIndexGen<0, I...> { typedef GammaIndex<I...> type; };
+
+// Table for one curve at one depth, as a field of a 5/6/5 color:
+template <uint16_t GAMMA, uint8_t DEPTH, uint8_t FIELD,
+	typename S = typename GammaIndexGen<256>::type>
+struct GammaTable;
+
+template <uint16_t GAMMA, uint8_t DEPTH, uint8_t FIELD, uint8_t... I>
+struct GammaTable<GAMMA, DEPTH, FIELD, GammaIndex<I...> > {
+	static constexpr uint8_t table[256] = {
+		gammaField(gammaLevel(I, GAMMA, DEPTH), DEPTH, FIELD)... };
 };
 
+template <uint16_t GAMMA, uint8_t DEPTH, uint8_t FIELD, uint8_t... I>
+constexpr uint8_t GammaTable<GAMMA, DEPTH, FIELD, GammaIndex<I...> >::table[256];
+
+// Per channel, indexed by plane count - 4.  A 5/6/5 color can't carry
+// more than 5 bits of red or blue or 6 of green, so deeper panels share
+// the last table.
+static const uint8_t * const gammaRed[] = {
+	GammaTable<GAMMA_RED, 4, 5>::table,
+	GammaTable<GAMMA_RED, 5, 5>::table };
+static const uint8_t * const gammaGreen[] = {
+	GammaTable<GAMMA_GREEN, 4, 6>::table,
+	GammaTable<GAMMA_GREEN, 5, 6>::table,
+	GammaTable<GAMMA_GREEN, 6, 6>::table };
+static const uint8_t * const gammaBlue[] = {
+	GammaTable<GAMMA_BLUE, 4, 5>::table,
+	GammaTable<GAMMA_BLUE, 5, 5>::table };
+
 #endif // _GAMMA_H_